@@ -0,0 +1,469 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Cores/GB/Core.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace MicroBench {
+    constexpr size_t ROM_SIZE = 0x10000;
+    constexpr uint16_t ALU_MIX_ADDRESS = 0x0200;
+    constexpr uint16_t LOAD_STORE_MIX_ADDRESS = 0x0300;
+    constexpr uint16_t BRANCH_MIX_ADDRESS = 0x0400;
+    constexpr uint16_t CB_MIX_ADDRESS = 0x0500;
+
+    constexpr int32_t LINES_PER_FRAME = 154;
+    constexpr int32_t VISIBLE_LINES = 144;
+    constexpr int32_t DOTS_PER_LINE = 456;
+    constexpr int32_t SPRITES_PER_LINE = 10;
+
+    struct Options {
+        int32_t runs = 5;
+        std::string filter;
+    };
+
+    struct Workload {
+        std::string_view name;
+        std::string_view unit;
+        int64_t ops = 0;
+        std::function<void(GB::Core &core)> setup;
+        std::function<void(GB::Core &core)> run;
+    };
+
+    struct MemoryRegion {
+        std::string_view name;
+        uint16_t start = 0;
+        uint16_t size = 0;
+    };
+
+    // Keeps the optimizer from discarding reads.
+    volatile uint8_t sink = 0;
+
+    void place(std::vector<uint8_t> &rom, uint16_t address, std::initializer_list<uint8_t> bytes) {
+        std::copy(bytes.begin(), bytes.end(), rom.begin() + address);
+    }
+
+    /*
+        64KB MBC5+RAM image with a few tight instruction loops. Every loop jumps back to its own
+        start so a CPU reset to its address keeps executing the same mix forever.
+    */
+    std::vector<uint8_t> build_rom() {
+        std::vector<uint8_t> rom(ROM_SIZE, 0x00);
+
+        // Entry point: jp 0x0150, then spin on jr -2.
+        place(rom, 0x0100, {0x00, 0xC3, 0x50, 0x01});
+        place(rom, 0x0134, {'M', 'I', 'C', 'R', 'O', 'B', 'E', 'N', 'C', 'H'});
+        rom[0x0147] = 0x1A;
+        rom[0x0148] = 0x01;
+        rom[0x0149] = 0x02;
+        place(rom, 0x0150, {0x18, 0xFE});
+
+        // inc a; add a,b; adc a,c; sub d; and e; xor h; or l; cp b; inc b; dec c;
+        // add a,0x11; xor 0x5A; jr start
+        place(rom, ALU_MIX_ADDRESS, {0x3C, 0x80, 0x89, 0x92, 0xA3, 0xAC, 0xB5, 0xB8, 0x04, 0x0D,
+                                     0xC6, 0x11, 0xEE, 0x5A, 0x18, 0xF0});
+
+        // ld a,(hl); ld (hl),a; ld (hl+),a; ld a,(hl+); ld b,(hl); ld (hl),b; ld (c010),a;
+        // ld a,(c010); push bc; pop de; ldh (80),a; ldh a,(80); ld hl,c000; jr start
+        place(rom, LOAD_STORE_MIX_ADDRESS,
+              {0x7E, 0x77, 0x22, 0x2A, 0x46, 0x70, 0xEA, 0x10, 0xC0, 0xFA, 0x10, 0xC0, 0xC5, 0xD1,
+               0xE0, 0x80, 0xF0, 0x80, 0x21, 0x00, 0xC0, 0x18, 0xE9});
+
+        // call sub; jp next; (padding) next: xor a; jr nz,+2; jr z,start; sub: ret
+        place(rom, BRANCH_MIX_ADDRESS, {0xCD, 0x10, 0x04, 0xC3, 0x08, 0x04, 0x00, 0x00, 0xAF,
+                                        0x20, 0x02, 0x28, 0xF3});
+        place(rom, BRANCH_MIX_ADDRESS + 0x10, {0xC9});
+
+        // ld hl,c000; loop: rlc b; rr c; swap a; bit 7,d; set 0,e; res 0,b; srl a; sla (hl);
+        // bit 0,(hl); jr loop
+        place(rom, CB_MIX_ADDRESS,
+              {0x21, 0x00, 0xC0, 0xCB, 0x00, 0xCB, 0x19, 0xCB, 0x37, 0xCB, 0x7A, 0xCB, 0xC3, 0xCB,
+               0x80, 0xCB, 0x3F, 0xCB, 0x26, 0xCB, 0x46, 0x18, 0xEC});
+
+        return rom;
+    }
+
+    std::unique_ptr<GB::Cartridge> load_rom() {
+        auto path = std::filesystem::temp_directory_path() / "bigcomboy_microbench.gb";
+        auto rom = build_rom();
+
+        {
+            std::ofstream out(path, std::ios::binary);
+            out.write(reinterpret_cast<const char *>(rom.data()),
+                      static_cast<std::streamsize>(rom.size()));
+        }
+
+        auto cart = GB::Cartridge::from_file(path);
+        std::filesystem::remove(path);
+        return cart;
+    }
+
+    void fill_video_memory(GB::Core &core) {
+        for (uint16_t i = 0; i < 0x1800; ++i) {
+            core.bus.write(0x8000 + i, static_cast<uint8_t>((i * 37) ^ (i >> 3)));
+        }
+
+        for (uint16_t i = 0; i < 0x800; ++i) {
+            core.bus.write(0x9800 + i, static_cast<uint8_t>(i * 7));
+        }
+
+        core.bus.write(0xFF47, 0xE4);
+        core.bus.write(0xFF48, 0xD2);
+        core.bus.write(0xFF49, 0x1B);
+    }
+
+    void place_line_sprites(GB::Core &core, uint8_t line) {
+        for (uint16_t i = 0; i < SPRITES_PER_LINE; ++i) {
+            core.ppu.write_oam(i * 4, line + 16);
+            core.ppu.write_oam(i * 4 + 1, static_cast<uint8_t>(8 + i * 15));
+            core.ppu.write_oam(i * 4 + 2, static_cast<uint8_t>(i));
+            core.ppu.write_oam(i * 4 + 3, static_cast<uint8_t>((i & 3) << 5));
+        }
+    }
+
+    void step_line(GB::Core &core) {
+        for (int32_t dot = 0; dot < DOTS_PER_LINE; dot += 4) {
+            core.ppu.step(4);
+        }
+    }
+
+    // Moves the sprites onto each line before it is scanned so every visible line draws 10.
+    void run_ppu_frame(GB::Core &core, bool sprites) {
+        for (int32_t line = 0; line < LINES_PER_FRAME; ++line) {
+            if (sprites && line < VISIBLE_LINES) {
+                place_line_sprites(core, static_cast<uint8_t>(line));
+            }
+
+            step_line(core);
+        }
+    }
+
+    void setup_ppu(GB::Core &core, bool sprites) {
+        fill_video_memory(core);
+
+        for (uint16_t i = 0; i < 0xA0; ++i) {
+            core.ppu.write_oam(i, 0);
+        }
+
+        core.bus.write(0xFF40, sprites ? 0x93 : 0x91);
+
+        // Align to the start of line 0 so every timed frame starts in the same state.
+        while (core.ppu.read_register(0x44) != 0 || (core.ppu.read_register(0x41) & 0x3) != 2) {
+            core.ppu.step(4);
+        }
+    }
+
+    void setup_apu(GB::Core &core) {
+        core.apu.set_samples_callback(GB::CPU_CLOCK_RATE / 48000, [](GB::SampleResult result) {
+            sink = sink ^ result.left_channel.pulse_1 ^ result.right_channel.noise;
+        });
+
+        // Power on, route every channel to both outputs and trigger all four.
+        constexpr std::array<std::pair<uint16_t, uint8_t>, 19> writes{{
+            {0xFF26, 0x80}, {0xFF24, 0x77}, {0xFF25, 0xFF}, {0xFF11, 0x80}, {0xFF12, 0xF3},
+            {0xFF13, 0x83}, {0xFF14, 0x87}, {0xFF16, 0x40}, {0xFF17, 0xF7}, {0xFF18, 0x00},
+            {0xFF19, 0x86}, {0xFF1A, 0x80}, {0xFF1C, 0x20}, {0xFF1D, 0x00}, {0xFF1E, 0x87},
+            {0xFF21, 0xF1}, {0xFF22, 0x52}, {0xFF23, 0x80}, {0xFF25, 0xFF},
+        }};
+
+        for (uint16_t i = 0; i < 16; ++i) {
+            core.bus.write(0xFF30 + i, static_cast<uint8_t>(i * 0x11));
+        }
+
+        for (auto [address, value] : writes) {
+            core.bus.write(address, value);
+        }
+    }
+
+    void run_apu_frame(GB::Core &core) {
+        for (int32_t cycles = 0; cycles < GB::CYCLES_PER_FRAME; cycles += 4) {
+            core.apu.step(4);
+
+            if ((cycles & 8191) == 0) {
+                core.apu.step_frame_sequencer();
+            }
+        }
+    }
+
+    void setup_bus(GB::Core &core) {
+        // Enable cartridge RAM so its region goes through the MBC like a game would.
+        core.bus.write(0x0000, 0x0A);
+        core.bus.write(0xFF40, 0x00);
+    }
+
+    void run_bus_reads(GB::Core &core, const MemoryRegion &region, int64_t count) {
+        uint8_t value = 0;
+
+        for (int64_t i = 0; i < count; ++i) {
+            value ^= core.bus.read(region.start + static_cast<uint16_t>((i * 97) % region.size));
+        }
+
+        sink = value;
+    }
+
+    void run_bus_writes(GB::Core &core, const MemoryRegion &region, int64_t count) {
+        for (int64_t i = 0; i < count; ++i) {
+            core.bus.write(region.start + static_cast<uint16_t>((i * 97) % region.size),
+                           static_cast<uint8_t>(i));
+        }
+    }
+
+    void setup_cpu(GB::Core &core, uint16_t address) {
+        // LCD off keeps the PPU out of the measurement as much as the core allows.
+        core.bus.write(0xFF40, 0x00);
+        core.cpu.reset(address);
+    }
+
+    void run_cpu(GB::Core &core, int64_t count) {
+        for (int64_t i = 0; i < count; ++i) {
+            core.cpu.step();
+        }
+    }
+
+    std::vector<Workload> make_workloads() {
+        constexpr int64_t FRAMES = 20;
+        constexpr int64_t BUS_OPS = 2000000;
+        constexpr int64_t INSTRUCTIONS = 2000000;
+
+        std::vector<Workload> workloads{
+            {
+                .name = "ppu.line.bg",
+                .unit = "line",
+                .ops = FRAMES * VISIBLE_LINES,
+                .setup = [](GB::Core &core) { setup_ppu(core, false); },
+                .run =
+                    [](GB::Core &core) {
+                        for (int64_t i = 0; i < FRAMES; ++i) {
+                            run_ppu_frame(core, false);
+                        }
+                    },
+            },
+            {
+                .name = "ppu.line.bg+10_sprites",
+                .unit = "line",
+                .ops = FRAMES * VISIBLE_LINES,
+                .setup = [](GB::Core &core) { setup_ppu(core, true); },
+                .run =
+                    [](GB::Core &core) {
+                        for (int64_t i = 0; i < FRAMES; ++i) {
+                            run_ppu_frame(core, true);
+                        }
+                    },
+            },
+            {
+                .name = "apu.frame",
+                .unit = "frame",
+                .ops = FRAMES,
+                .setup = setup_apu,
+                .run =
+                    [](GB::Core &core) {
+                        for (int64_t i = 0; i < FRAMES; ++i) {
+                            run_apu_frame(core);
+                        }
+                    },
+            },
+        };
+
+        static constexpr std::array<MemoryRegion, 10> read_regions{{
+            {"rom0", 0x0000, 0x4000},
+            {"romx", 0x4000, 0x4000},
+            {"vram", 0x8000, 0x2000},
+            {"eram", 0xA000, 0x2000},
+            {"wram0", 0xC000, 0x1000},
+            {"wramx", 0xD000, 0x1000},
+            {"echo", 0xE000, 0x1E00},
+            {"oam", 0xFE00, 0xA0},
+            {"io", 0xFF00, 0x80},
+            {"hram", 0xFF80, 0x7F},
+        }};
+
+        // Only registers without side effects beyond their own state are written.
+        static constexpr std::array<MemoryRegion, 11> write_regions{{
+            {"mbc", 0x2000, 0x1000},
+            {"vram", 0x8000, 0x2000},
+            {"eram", 0xA000, 0x2000},
+            {"wram0", 0xC000, 0x1000},
+            {"wramx", 0xD000, 0x1000},
+            {"echo", 0xE000, 0x1E00},
+            {"oam", 0xFE00, 0xA0},
+            {"io.scroll", 0xFF42, 0x2},
+            {"io.wave", 0xFF30, 0x10},
+            {"hram", 0xFF80, 0x7F},
+            {"ie", 0xFFFF, 0x1},
+        }};
+
+        static const std::array<std::string, read_regions.size()> read_names = [] {
+            std::array<std::string, read_regions.size()> names;
+            for (size_t i = 0; i < read_regions.size(); ++i) {
+                names[i] = "bus.read." + std::string(read_regions[i].name);
+            }
+            return names;
+        }();
+
+        static const std::array<std::string, write_regions.size()> write_names = [] {
+            std::array<std::string, write_regions.size()> names;
+            for (size_t i = 0; i < write_regions.size(); ++i) {
+                names[i] = "bus.write." + std::string(write_regions[i].name);
+            }
+            return names;
+        }();
+
+        for (size_t i = 0; i < read_regions.size(); ++i) {
+            const auto &region = read_regions[i];
+
+            workloads.push_back({
+                .name = read_names[i],
+                .unit = "read",
+                .ops = BUS_OPS,
+                .setup = setup_bus,
+                .run = [&region](GB::Core &core) { run_bus_reads(core, region, BUS_OPS); },
+            });
+        }
+
+        for (size_t i = 0; i < write_regions.size(); ++i) {
+            const auto &region = write_regions[i];
+
+            workloads.push_back({
+                .name = write_names[i],
+                .unit = "write",
+                .ops = BUS_OPS,
+                .setup = setup_bus,
+                .run = [&region](GB::Core &core) { run_bus_writes(core, region, BUS_OPS); },
+            });
+        }
+
+        static constexpr std::array<std::pair<std::string_view, uint16_t>, 4> mixes{{
+            {"sm83.alu", ALU_MIX_ADDRESS},
+            {"sm83.load_store", LOAD_STORE_MIX_ADDRESS},
+            {"sm83.branch", BRANCH_MIX_ADDRESS},
+            {"sm83.cb", CB_MIX_ADDRESS},
+        }};
+
+        for (const auto &[name, address] : mixes) {
+            workloads.push_back({
+                .name = name,
+                .unit = "instruction",
+                .ops = INSTRUCTIONS,
+                .setup = [address](GB::Core &core) { setup_cpu(core, address); },
+                .run = [](GB::Core &core) { run_cpu(core, INSTRUCTIONS); },
+            });
+        }
+
+        return workloads;
+    }
+
+    void print_usage() {
+        std::cerr << "Usage: BigComBoyMicroBench [--runs N] [--filter <name prefix>]\n";
+    }
+
+    // Parses the whole of text as a number; value is left unchanged when it is not one.
+    template <typename T> bool parse_number(std::string_view text, T &value) {
+        const char *end = text.data() + text.size();
+        auto [last, error] = std::from_chars(text.data(), end, value);
+
+        return error == std::errc{} && last == end;
+    }
+
+    bool parse_arguments(int argc, char *argv[], Options &options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            bool has_value = (i + 1) < argc;
+
+            if (arg == "--runs" && has_value) {
+                if (!parse_number(argv[++i], options.runs)) {
+                    return false;
+                }
+            } else if (arg == "--filter" && has_value) {
+                options.filter = argv[++i];
+            } else {
+                return false;
+            }
+        }
+
+        return options.runs > 0;
+    }
+
+    double time_run(GB::Core &core, GB::Cartridge &cart, const Workload &workload) {
+        using clock = std::chrono::steady_clock;
+
+        core.initialize(&cart);
+        workload.setup(core);
+
+        auto start = clock::now();
+        workload.run(core);
+        auto elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+        return elapsed / static_cast<double>(workload.ops);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    MicroBench::Options options{};
+
+    if (!MicroBench::parse_arguments(argc, argv, options)) {
+        MicroBench::print_usage();
+        return 1;
+    }
+
+    auto cart = MicroBench::load_rom();
+
+    if (!cart) {
+        std::cerr << "Failed to create the synthetic ROM.\n";
+        return 1;
+    }
+
+    auto core = std::make_unique<GB::Core>();
+
+    std::cout << std::left << std::setw(28) << "workload" << std::setw(13) << "unit" << std::right
+              << std::setw(12) << "ns/op min" << std::setw(12) << "ns/op med" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (const auto &workload : MicroBench::make_workloads()) {
+        if (!workload.name.starts_with(options.filter)) {
+            continue;
+        }
+
+        // One untimed pass to warm caches and the branch predictor.
+        MicroBench::time_run(*core, *cart, workload);
+
+        std::vector<double> samples;
+        for (int32_t i = 0; i < options.runs; ++i) {
+            samples.push_back(MicroBench::time_run(*core, *cart, workload));
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        std::cout << std::left << std::setw(28) << workload.name << std::setw(13) << workload.unit
+                  << std::right << std::setw(12) << samples.front() << std::setw(12)
+                  << samples[samples.size() / 2] << "\n";
+    }
+
+    return 0;
+}
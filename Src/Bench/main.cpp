@@ -0,0 +1,338 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Cores/GB/Core.hpp"
+#include "Cores/GB/OpcodeProfiler.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace Bench {
+    struct Options {
+        std::filesystem::path rom_path;
+        std::filesystem::path bootstrap_path;
+        std::filesystem::path opcode_profile_path;
+        GB::ConsoleType console = GB::ConsoleType::AutoSelect;
+        int32_t frames = 3600;
+        int32_t warmup_frames = 60;
+        int32_t runs = 5;
+        bool block_cache = false;
+    };
+
+    struct RunResult {
+        int64_t total_ns = 0;
+        std::vector<int64_t> frame_times{};
+        GB::CoreProfile profile{};
+    };
+
+    void print_usage() {
+        std::cerr << "Usage: BigComBoyBench <rom> [--frames N] [--runs N] [--warmup N]\n"
+                     "                      [--console dmg|cgb --bootstrap <path>]\n"
+                     "                      [--opcode-profile <report path>] [--block-cache]\n";
+    }
+
+    // Parses the whole of text as a number; value is left unchanged when it is not one.
+    template <typename T> bool parse_number(std::string_view text, T &value) {
+        const char *end = text.data() + text.size();
+        auto [last, error] = std::from_chars(text.data(), end, value);
+
+        return error == std::errc{} && last == end;
+    }
+
+    bool parse_arguments(int argc, char *argv[], Options &options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            bool has_value = (i + 1) < argc;
+
+            if (arg == "--frames" && has_value) {
+                if (!parse_number(argv[++i], options.frames)) {
+                    return false;
+                }
+            } else if (arg == "--runs" && has_value) {
+                if (!parse_number(argv[++i], options.runs)) {
+                    return false;
+                }
+            } else if (arg == "--warmup" && has_value) {
+                if (!parse_number(argv[++i], options.warmup_frames)) {
+                    return false;
+                }
+            } else if (arg == "--opcode-profile" && has_value) {
+                options.opcode_profile_path = argv[++i];
+            } else if (arg == "--block-cache") {
+                options.block_cache = true;
+            } else if (arg == "--bootstrap" && has_value) {
+                options.bootstrap_path = argv[++i];
+            } else if (arg == "--console" && has_value) {
+                std::string_view console = argv[++i];
+
+                if (console == "dmg") {
+                    options.console = GB::ConsoleType::DMG;
+                } else if (console == "cgb") {
+                    options.console = GB::ConsoleType::CGB;
+                } else {
+                    return false;
+                }
+            } else if (!arg.starts_with("--") && options.rom_path.empty()) {
+                options.rom_path = arg;
+            } else {
+                return false;
+            }
+        }
+
+        if (options.console != GB::ConsoleType::AutoSelect && options.bootstrap_path.empty()) {
+            return false;
+        }
+
+        return !options.rom_path.empty() && options.frames > 0 && options.runs > 0 &&
+               options.warmup_frames >= 0;
+    }
+
+    void initialize_core(GB::Core &core, GB::Cartridge &cart, const Options &options) {
+        if (options.console == GB::ConsoleType::AutoSelect) {
+            core.initialize(&cart);
+        } else {
+            core.initialize_with_bootstrap(&cart, options.console, options.bootstrap_path);
+        }
+
+        core.cpu.set_block_cache_enabled(options.block_cache);
+
+        // Generate samples at the same rate as the frontend so APU mixing cost is included.
+        core.apu.set_samples_callback(GB::CPU_CLOCK_RATE / 48000, [](GB::SampleResult) {});
+    }
+
+    RunResult run_once(GB::Cartridge &cart, const Options &options) {
+        using clock = std::chrono::steady_clock;
+
+        auto core = std::make_unique<GB::Core>();
+        initialize_core(*core, cart, options);
+        core->run_for_frames(options.warmup_frames);
+        core->reset_profile();
+
+        RunResult result{};
+        result.frame_times.reserve(options.frames);
+
+        auto run_start = clock::now();
+        for (int32_t i = 0; i < options.frames; ++i) {
+            auto frame_start = clock::now();
+            core->run_for_frames(1);
+            auto frame_end = clock::now();
+
+            result.frame_times.push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(frame_end - frame_start)
+                    .count());
+        }
+
+        result.total_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - run_start).count();
+        result.profile = core->profile();
+
+        return result;
+    }
+
+    // Runs separately from the timed runs so the per-instruction bookkeeping doesn't skew them.
+    bool write_opcode_profile(GB::Cartridge &cart, const Options &options) {
+        std::ofstream out(options.opcode_profile_path);
+
+        if (!out) {
+            return false;
+        }
+
+        GB::OpcodeProfiler profiler{};
+        auto core = std::make_unique<GB::Core>();
+        initialize_core(*core, cart, options);
+        core->run_for_frames(options.warmup_frames);
+        core->cpu.set_opcode_profiler(&profiler);
+        core->run_for_frames(options.frames);
+        core->cpu.set_opcode_profiler(nullptr);
+
+        out << "rom: " << options.rom_path.string() << "\n";
+        out << "frames: " << options.frames << "\n";
+        profiler.write_report(out);
+
+        return true;
+    }
+
+    int64_t percentile(const std::vector<int64_t> &sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+
+        auto rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    void write_json_string(std::ostream &out, std::string_view str) {
+        out << '"';
+
+        for (char c : str) {
+            switch (c) {
+            case '"': {
+                out << "\\\"";
+                break;
+            }
+            case '\\': {
+                out << "\\\\";
+                break;
+            }
+            default: {
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << ' ';
+                } else {
+                    out << c;
+                }
+                break;
+            }
+            }
+        }
+
+        out << '"';
+    }
+
+    void write_profile(std::ostream &out, const std::vector<RunResult> &runs) {
+        uint64_t frames = 0;
+        int64_t total_ns = 0;
+
+        for (const auto &run : runs) {
+            frames += run.profile.frames();
+            total_ns += run.total_ns;
+        }
+
+        out << ",\n  \"profile\": {\"frames\": " << frames << ", \"components\": [";
+
+        for (size_t i = 0; i < GB::PROFILE_COMPONENT_COUNT; ++i) {
+            auto id = static_cast<GB::ProfileComponent>(i);
+            GB::ComponentProfile sum{};
+
+            for (const auto &run : runs) {
+                const auto &component = run.profile.component(id);
+                sum.calls += component.calls;
+                sum.inclusive_ns += component.inclusive_ns;
+                sum.exclusive_ns += component.exclusive_ns;
+            }
+
+            out << (i ? "," : "") << "\n    {\"name\": ";
+            write_json_string(out, GB::PROFILE_COMPONENT_NAMES[i]);
+            out << ", \"calls\": " << sum.calls << ", \"inclusive_ns\": " << sum.inclusive_ns
+                << ", \"exclusive_ns\": " << sum.exclusive_ns << ", \"exclusive_ns_per_frame\": "
+                << (frames ? static_cast<double>(sum.exclusive_ns) / frames : 0.0)
+                << ", \"exclusive_percent\": "
+                << 100.0 * static_cast<double>(sum.exclusive_ns) / static_cast<double>(total_ns)
+                << "}";
+        }
+
+        out << "\n  ]}";
+    }
+
+    void write_report(std::ostream &out, const Options &options, const GB::Cartridge &cart,
+                      const std::vector<RunResult> &runs) {
+        std::vector<int64_t> all_frames;
+        std::vector<double> run_fps;
+
+        for (const auto &run : runs) {
+            all_frames.insert(all_frames.end(), run.frame_times.begin(), run.frame_times.end());
+            run_fps.push_back(static_cast<double>(options.frames) * 1e9 /
+                              static_cast<double>(run.total_ns));
+        }
+
+        std::sort(all_frames.begin(), all_frames.end());
+
+        double mean_ns = static_cast<double>(std::accumulate(all_frames.begin(),
+                                                             all_frames.end(), int64_t{0})) /
+                         static_cast<double>(all_frames.size());
+        auto sorted_fps = run_fps;
+        std::sort(sorted_fps.begin(), sorted_fps.end());
+
+        std::string title = cart.header().title.c_str();
+
+        out << std::fixed << std::setprecision(2);
+        out << "{\n";
+        out << "  \"rom\": ";
+        write_json_string(out, options.rom_path.string());
+        out << ",\n  \"title\": ";
+        write_json_string(out, title);
+        out << ",\n  \"frames_per_run\": " << options.frames;
+        out << ",\n  \"warmup_frames\": " << options.warmup_frames;
+        out << ",\n  \"block_cache\": " << (options.block_cache ? "true" : "false");
+        out << ",\n  \"runs\": [";
+
+        for (size_t i = 0; i < runs.size(); ++i) {
+            out << (i ? ", " : "") << "{\"fps\": " << run_fps[i]
+                << ", \"total_ns\": " << runs[i].total_ns << "}";
+        }
+
+        out << "],\n  \"fps\": {\"min\": " << sorted_fps.front()
+            << ", \"median\": " << sorted_fps[sorted_fps.size() / 2]
+            << ", \"max\": " << sorted_fps.back() << "}";
+        out << ",\n  \"ns_per_frame\": {\"mean\": " << mean_ns
+            << ", \"min\": " << all_frames.front() << ", \"p50\": " << percentile(all_frames, 50)
+            << ", \"p90\": " << percentile(all_frames, 90)
+            << ", \"p95\": " << percentile(all_frames, 95)
+            << ", \"p99\": " << percentile(all_frames, 99) << ", \"max\": " << all_frames.back()
+            << "}";
+        out << ",\n  \"realtime_multiplier\": "
+            << (1e9 / mean_ns) / (static_cast<double>(GB::CPU_CLOCK_RATE) / GB::CYCLES_PER_FRAME);
+
+        if (runs.front().profile.enabled()) {
+            write_profile(out, runs);
+        }
+
+        out << "\n}\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Bench::Options options{};
+
+    if (!Bench::parse_arguments(argc, argv, options)) {
+        Bench::print_usage();
+        return 1;
+    }
+
+    auto cart = GB::Cartridge::from_file(options.rom_path);
+
+    if (!cart) {
+        std::cerr << "Failed to load ROM: " << options.rom_path.string() << "\n";
+        return 1;
+    }
+
+    std::vector<Bench::RunResult> runs;
+    for (int32_t i = 0; i < options.runs; ++i) {
+        runs.push_back(Bench::run_once(*cart, options));
+    }
+
+    Bench::write_report(std::cout, options, *cart, runs);
+
+    if (!options.opcode_profile_path.empty() && !Bench::write_opcode_profile(*cart, options)) {
+        std::cerr << "Failed to write opcode profile: " << options.opcode_profile_path.string()
+                  << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -17,6 +17,7 @@
 */
 
 #include "Config.hpp"
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <toml.hpp>
@@ -50,7 +51,9 @@ namespace Common {
             {"sram_save_interval", gameboy.emulation.sram_save_interval},
             {"frame_blending", gameboy.video.frame_blending},
             {"smooth_scaling", gameboy.video.smooth_scaling},
+            {"show_telemetry", gameboy.video.show_telemetry},
             {"screen_filter", gameboy.video.screen_filter},
+            {"color_correction", static_cast<int32_t>(gameboy.video.color_correction)},
             {"volume", gameboy.audio.volume},
             {"square1", gameboy.audio.square1},
             {"square2", gameboy.audio.square2},
@@ -135,6 +138,13 @@ namespace Common {
             toml::find_or(gb, "smooth_scaling", gameboy.video.smooth_scaling);
         gameboy.video.screen_filter =
             toml::find_or(gb, "screen_filter", gameboy.video.screen_filter);
+        gameboy.video.show_telemetry =
+            toml::find_or(gb, "show_telemetry", gameboy.video.show_telemetry);
+        auto color_correction = toml::find_or(
+            gb, "color_correction", static_cast<int32_t>(gameboy.video.color_correction));
+        gameboy.video.color_correction = static_cast<GB::ColorCorrection>(
+            std::clamp(color_correction, static_cast<int32_t>(GB::ColorCorrection::Raw),
+                       static_cast<int32_t>(GB::ColorCorrection::Gamma)));
 
         gameboy.audio.volume = toml::find_or(gb, "volume", gameboy.audio.volume);
         gameboy.audio.square1 = toml::find_or(gb, "square1", gameboy.audio.square1);
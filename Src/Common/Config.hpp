@@ -36,6 +36,8 @@ namespace Common {
             std::string screen_filter = "No Filter";
             bool frame_blending = true;
             bool smooth_scaling = false;
+            bool show_telemetry = false;
+            GB::ColorCorrection color_correction = GB::ColorCorrection::Raw;
         } video;
 
         struct EmulationData {
@@ -17,7 +17,9 @@
 */
 
 #include "APU.hpp"
+#include "Core.hpp"
 #include <array>
+#include <stdexcept>
 
 namespace GB {
     // Fixes Final Fantasy Adventure because it mutes channels by setting the frequency to max
@@ -525,7 +527,14 @@ namespace GB {
 
     uint8_t NoiseChannel::read_nr44() const { return length.sound_length_enable << 6; }
 
+    APU::APU(Core *core) : core(core) {
+        if (!core) {
+            throw std::invalid_argument("Core cannot be null.");
+        }
+    }
+
     void APU::reset() {
+        synced_cycles = core->elapsed_cycles();
         stereo_left_volume = 7;
         stereo_right_volume = 7;
         mix_vin_left = false;
@@ -548,6 +557,8 @@ namespace GB {
     }
 
     uint8_t APU::read_register(uint8_t address) {
+        sync();
+
         switch (address) {
         // Pulse 1
         case 0x10: {
@@ -635,6 +646,8 @@ namespace GB {
     }
 
     void APU::write_register(uint8_t address, uint8_t value) {
+        sync();
+
         if (power) {
             switch (address) {
             case 0x10: {
@@ -763,9 +776,15 @@ namespace GB {
         }
     }
 
-    uint8_t APU::read_wave_ram(uint8_t address) { return wave_table[address]; }
+    uint8_t APU::read_wave_ram(uint8_t address) {
+        sync();
+        return wave_table[address];
+    }
 
-    void APU::write_wave_ram(uint8_t address, uint8_t value) { wave_table[address] = value; }
+    void APU::write_wave_ram(uint8_t address, uint8_t value) {
+        sync();
+        wave_table[address] = value;
+    }
 
     void APU::write_nr52(uint8_t value) {
         power = (value & 0b10000000) > 0;
@@ -847,7 +866,7 @@ namespace GB {
             noise.step();
             sample_counter++;
 
-            if (sample_counter % sample_rate == 0) {
+            if (sample_rate && (sample_counter % sample_rate == 0)) {
                 if (samples_ready_func) {
                     SampleResult result;
                     result.left_channel.master_volume = stereo_left_volume;
@@ -866,6 +885,18 @@ namespace GB {
             }
         }
     }
+    // Runs the channels up to the master clock. Nothing the APU does is visible to the CPU
+    // without going through a register, so it only catches up on access, before a frame
+    // sequencer step and at the end of every frame.
+    void APU::sync() { sync_to(core->elapsed_cycles()); }
+
+    void APU::sync_to(uint64_t timestamp) {
+        if (timestamp > synced_cycles) {
+            step(static_cast<int32_t>(timestamp - synced_cycles));
+            synced_cycles = timestamp;
+        }
+    }
+
     void APU::step_frame_sequencer() {
         switch (frame_sequencer_counter) {
         case 0:
@@ -22,6 +22,8 @@
 #include <functional>
 
 namespace GB {
+    class Core;
+
     class LengthCounter {
     public:
         void step_length(bool &channel_on);
@@ -186,6 +188,8 @@ namespace GB {
 
     class APU {
     public:
+        APU(Core *core);
+
         void reset();
         void set_samples_callback(int32_t rate, std::function<void(SampleResult result)> cb);
 
@@ -206,8 +210,13 @@ namespace GB {
 
         void step(int32_t cycles);
         void step_frame_sequencer();
+        void sync();
+        void sync_to(uint64_t timestamp);
 
     private:
+        Core *core;
+        uint64_t synced_cycles = 0;
+
         bool mix_vin_left = false;
         bool mix_vin_right = false;
         bool power = false;
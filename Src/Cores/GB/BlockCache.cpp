@@ -0,0 +1,159 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "BlockCache.hpp"
+#include <utility>
+
+namespace GB {
+    DecodedBlock *BlockCache::find(int32_t bank, uint16_t address) {
+        auto it = blocks.find(key(bank, address));
+
+        return it != blocks.end() ? &it->second : nullptr;
+    }
+
+    DecodedBlock &BlockCache::insert(int32_t bank, uint16_t address, DecodedBlock block) {
+        return blocks.insert_or_assign(key(bank, address), std::move(block)).first->second;
+    }
+
+    void BlockCache::clear() { blocks.clear(); }
+
+    size_t BlockCache::size() const { return blocks.size(); }
+
+    uint32_t BlockCache::key(int32_t bank, uint16_t address) {
+        return (static_cast<uint32_t>(bank) << 16) | address;
+    }
+
+    uint8_t instruction_length(uint8_t opcode) {
+        switch (opcode) {
+        case 0x06:
+        case 0x0E:
+        case 0x10:
+        case 0x16:
+        case 0x18:
+        case 0x1E:
+        case 0x20:
+        case 0x26:
+        case 0x28:
+        case 0x2E:
+        case 0x30:
+        case 0x36:
+        case 0x38:
+        case 0x3E:
+        case 0xC6:
+        case 0xCB:
+        case 0xCE:
+        case 0xD6:
+        case 0xDE:
+        case 0xE0:
+        case 0xE6:
+        case 0xE8:
+        case 0xEE:
+        case 0xF0:
+        case 0xF6:
+        case 0xF8:
+        case 0xFE: {
+            return 2;
+        }
+
+        case 0x01:
+        case 0x08:
+        case 0x11:
+        case 0x21:
+        case 0x31:
+        case 0xC2:
+        case 0xC3:
+        case 0xC4:
+        case 0xCA:
+        case 0xCC:
+        case 0xCD:
+        case 0xD2:
+        case 0xD4:
+        case 0xDA:
+        case 0xDC:
+        case 0xEA:
+        case 0xFA: {
+            return 3;
+        }
+
+        default: {
+            return 1;
+        }
+        }
+    }
+
+    bool ends_block(uint8_t opcode) {
+        switch (opcode) {
+        // stop, halt
+        case 0x10:
+        case 0x76:
+        // jr
+        case 0x18:
+        case 0x20:
+        case 0x28:
+        case 0x30:
+        case 0x38:
+        // ret, reti
+        case 0xC0:
+        case 0xC8:
+        case 0xC9:
+        case 0xD0:
+        case 0xD8:
+        case 0xD9:
+        // jp
+        case 0xC2:
+        case 0xC3:
+        case 0xCA:
+        case 0xD2:
+        case 0xDA:
+        case 0xE9:
+        // call
+        case 0xC4:
+        case 0xCC:
+        case 0xCD:
+        case 0xD4:
+        case 0xDC:
+        // rst
+        case 0xC7:
+        case 0xCF:
+        case 0xD7:
+        case 0xDF:
+        case 0xE7:
+        case 0xEF:
+        case 0xF7:
+        case 0xFF:
+        // illegal opcodes lock up the CPU
+        case 0xD3:
+        case 0xDB:
+        case 0xDD:
+        case 0xE3:
+        case 0xE4:
+        case 0xEB:
+        case 0xEC:
+        case 0xED:
+        case 0xF4:
+        case 0xFC:
+        case 0xFD: {
+            return true;
+        }
+
+        default: {
+            return false;
+        }
+        }
+    }
+}
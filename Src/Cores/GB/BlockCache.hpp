@@ -0,0 +1,69 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace GB {
+    class SM83;
+
+    // Longest run of instructions decoded into a single block.
+    constexpr size_t BLOCK_CACHE_MAX_INSTRUCTIONS = 64;
+
+    struct DecodedInstruction {
+        void (*handler)(SM83 &cpu) = nullptr;
+        uint16_t pc = 0;
+        std::array<uint8_t, 3> bytes{};
+    };
+
+    struct DecodedBlock {
+        std::vector<DecodedInstruction> instructions;
+#ifdef GB_ENABLE_JIT
+        uint32_t executions = 0;
+        void (*native)(SM83 &cpu) = nullptr;
+#endif
+    };
+
+    /*
+        Holds ROM basic blocks that have already been decoded into handler pointers and operand
+        bytes, keyed by (ROM bank, address) so that switching banks selects different entries
+        rather than invalidating them. Only code executing from cartridge ROM is cached; see
+        SM83::set_block_cache_enabled.
+    */
+    class BlockCache {
+    public:
+        DecodedBlock *find(int32_t bank, uint16_t address);
+        DecodedBlock &insert(int32_t bank, uint16_t address, DecodedBlock block);
+        void clear();
+        size_t size() const;
+
+    private:
+        static uint32_t key(int32_t bank, uint16_t address);
+
+        std::unordered_map<uint32_t, DecodedBlock> blocks;
+    };
+
+    // Opcode length in bytes including the opcode itself (CB-prefixed opcodes count as 2).
+    uint8_t instruction_length(uint8_t opcode);
+    // True for instructions that may leave the straight-line path (jumps, calls, returns...).
+    bool ends_block(uint8_t opcode);
+}
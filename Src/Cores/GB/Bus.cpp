@@ -25,6 +25,8 @@ namespace GB {
         if (!core) {
             throw std::invalid_argument("Core cannot be null.");
         }
+
+        remap_wram();
     }
 
     bool MainBus::bootstrap_mapped() const { return bootstrap_mapped_; }
@@ -37,9 +39,203 @@ namespace GB {
         wram.fill(0);
         hram.fill(0);
         cart = new_cart;
+        remap_cartridge(ALL_WINDOWS);
+        remap_wram();
+        init_io_registers();
+    }
+
+    void MainBus::unmap_bootstrap() {
+        bootstrap_mapped_ = false;
+        remap_cartridge(ROM0_WINDOW | ROMX_WINDOW);
+        core->cpu.rom_mapping_changed();
     }
 
-    uint8_t MainBus::read(uint16_t address) {
+    void MainBus::remap_cartridge(uint8_t windows) {
+        for (uint32_t window = 0; window < 2; ++window) {
+            if (!(windows & (ROM0_WINDOW << window))) {
+                continue;
+            }
+
+            uint32_t first_page = window * 0x40;
+            const uint8_t *rom = cart ? cart->rom_window(first_page << 8) : nullptr;
+
+            for (uint32_t page = 0; page < 0x40; ++page) {
+                read_pages[first_page + page] = rom ? (rom + (page << 8)) : nullptr;
+            }
+
+            // The boot ROM overlays everything but the header page while it is mapped.
+            if (bootstrap_mapped_) {
+                for (uint32_t page = first_page; page < (first_page + 0x40); ++page) {
+                    if (page != 0x01) {
+                        read_pages[page] = nullptr;
+                    }
+                }
+            }
+        }
+
+        if (windows & RAM_WINDOW) {
+            uint8_t *ram = cart ? cart->ram_window() : nullptr;
+
+            for (uint32_t page = 0; page < 0x20; ++page) {
+                read_pages[0xA0 + page] = ram ? (ram + (page << 8)) : nullptr;
+                write_pages[0xA0 + page] = ram ? (ram + (page << 8)) : nullptr;
+            }
+        }
+    }
+
+    void MainBus::remap_wram() {
+        for (uint32_t page = 0xC0; page < 0xFE; ++page) {
+            // E000-FDFF echoes C000-DDFF, including the switchable D bank.
+            uint32_t offset = ((page & 0x1F) << 8);
+            if (offset >= 0x1000) {
+                offset += (wram_bank_num - 1) * 0x1000;
+            }
+
+            read_pages[page] = wram.data() + offset;
+            write_pages[page] = wram.data() + offset;
+        }
+    }
+
+    void MainBus::init_io_registers() {
+        io_registers.fill({});
+
+        auto map = [this](uint8_t first, uint8_t last, IORegister reg) {
+            for (uint32_t io_address = first; io_address <= last; ++io_address) {
+                io_registers[io_address] = reg;
+            }
+        };
+
+        // Input
+        map(0x00, 0x00,
+            {[](MainBus &bus, uint8_t) -> uint8_t { return bus.core->pad.get_pad_state(); },
+             [](MainBus &bus, uint8_t, uint8_t value) {
+                 bus.core->pad.select_button_mode(value);
+             }});
+
+        // Serial Port
+        map(0x01, 0x02,
+            {[](MainBus &bus, uint8_t reg) { return bus.core->serial.read_register(reg); },
+             [](MainBus &bus, uint8_t reg, uint8_t value) {
+                 bus.core->serial.write_register(reg, value);
+             },
+             IO_SYNCS_SERIAL | IO_SCHEDULES_EVENTS});
+
+        // Timer, DIV resets also clock the APU frame sequencer.
+        IORegister timer{
+            [](MainBus &bus, uint8_t reg) { return bus.core->timer.read_register(reg); },
+            [](MainBus &bus, uint8_t reg, uint8_t value) {
+                bus.core->timer.write_register(reg, value);
+            },
+            IO_SYNCS_TIMER | IO_SCHEDULES_EVENTS};
+        map(0x05, 0x07, timer);
+        timer.flags |= IO_SYNCS_APU;
+        map(0x04, 0x04, timer);
+
+        // IF collects requests from the PPU, timer and serial port, a write can end HALT.
+        map(0x0F, 0x0F,
+            {[](MainBus &bus, uint8_t) { return bus.core->cpu.interrupt_flag; },
+             [](MainBus &bus, uint8_t, uint8_t value) { bus.core->cpu.interrupt_flag = value; },
+             IO_SYNCS_PPU | IO_SYNCS_TIMER | IO_SYNCS_SERIAL | IO_SCHEDULES_EVENTS});
+
+        // APU and Wave RAM
+        map(0x10, 0x27,
+            {[](MainBus &bus, uint8_t reg) { return bus.core->apu.read_register(reg); },
+             [](MainBus &bus, uint8_t reg, uint8_t value) {
+                 bus.core->apu.write_register(reg, value);
+             },
+             IO_SYNCS_APU});
+        map(0x30, 0x3F,
+            {[](MainBus &bus, uint8_t reg) { return bus.core->apu.read_wave_ram(reg - 0x30); },
+             [](MainBus &bus, uint8_t reg, uint8_t value) {
+                 bus.core->apu.write_wave_ram(reg - 0x30, value);
+             },
+             IO_SYNCS_APU});
+
+        // PPU Registers, LCDC/STAT/LYC writes can move the next STAT or mode event.
+        IORegister ppu{
+            [](MainBus &bus, uint8_t reg) { return bus.core->ppu.read_register(reg); },
+            [](MainBus &bus, uint8_t reg, uint8_t value) {
+                bus.core->ppu.write_register(reg, value);
+            },
+            IO_SYNCS_PPU};
+        map(0x42, 0x43, ppu);
+        map(0x46, 0x4B, ppu);
+        map(0x4F, 0x4F, ppu);
+        map(0x68, 0x6C, ppu);
+
+        IORegister ly = ppu;
+        ly.write = nullptr;
+        map(0x44, 0x44, ly);
+
+        ppu.flags |= IO_SCHEDULES_EVENTS;
+        map(0x40, 0x41, ppu);
+        map(0x45, 0x45, ppu);
+
+        map(0x4C, 0x4C,
+            {[](MainBus &bus, uint8_t) { return bus.KEY0; },
+             [](MainBus &bus, uint8_t, uint8_t value) {
+                 if (bus.bootstrap_mapped_) {
+                     bus.core->ppu.sync();
+                     bus.KEY0 = value;
+                     bus.core->ppu.set_compatibility_mode(bus.is_compatibility_mode());
+                 }
+             },
+             IO_SYNCS_PPU});
+        // Arming a speed switch changes the length of every tick after the next STOP.
+        map(0x4D, 0x4D,
+            {[](MainBus &bus, uint8_t) -> uint8_t {
+                 return bus.is_compatibility_mode() ? 0xFF : bus.core->cpu.KEY1;
+             },
+             [](MainBus &bus, uint8_t, uint8_t value) {
+                 bus.core->cpu.KEY1 &= ~0x1;
+                 bus.core->cpu.KEY1 |= value & 0x1;
+             },
+             IO_SCHEDULES_EVENTS});
+        map(0x50, 0x50,
+            {[](MainBus &bus, uint8_t) -> uint8_t { return bus.bootstrap_mapped_; },
+             [](MainBus &bus, uint8_t, uint8_t) { bus.unmap_bootstrap(); }, IO_REMAPS_MEMORY});
+
+        // HDMA
+        map(0x51, 0x51, {nullptr, [](MainBus &bus, uint8_t, uint8_t value) {
+                             bus.core->dma.set_hdma1(value);
+                         }});
+        map(0x52, 0x52, {nullptr, [](MainBus &bus, uint8_t, uint8_t value) {
+                             bus.core->dma.set_hdma2(value);
+                         }});
+        map(0x53, 0x53, {nullptr, [](MainBus &bus, uint8_t, uint8_t value) {
+                             bus.core->dma.set_hdma3(value);
+                         }});
+        map(0x54, 0x54, {nullptr, [](MainBus &bus, uint8_t, uint8_t value) {
+                             bus.core->dma.set_hdma4(value);
+                         }});
+        map(0x55, 0x55,
+            {[](MainBus &bus, uint8_t) { return bus.core->dma.get_dma_status(); },
+             [](MainBus &bus, uint8_t, uint8_t value) { bus.core->dma.set_dma_control(value); },
+             IO_SYNCS_PPU | IO_SCHEDULES_EVENTS});
+
+        map(0x70, 0x70,
+            {[](MainBus &bus, uint8_t) { return bus.wram_bank_num; },
+             [](MainBus &bus, uint8_t, uint8_t value) {
+                 value &= 0x7;
+                 bus.wram_bank_num = value ? value : 1;
+                 bus.remap_wram();
+             },
+             IO_REMAPS_MEMORY});
+    }
+
+    int32_t MainBus::rom_bank(uint16_t address) const {
+        if (address >= 0x8000) {
+            return 0;
+        }
+
+        if (bootstrap_mapped_ && ((address < 0x100) || (address > 0x1FF))) {
+            return BOOTSTRAP_ROM_BANK;
+        }
+
+        return cart ? cart->rom_bank(address) : 0;
+    }
+
+    uint8_t MainBus::read_slow(uint16_t address) {
         auto page = address >> 12;
 
         switch (page) {
@@ -76,146 +272,24 @@ namespace GB {
             }
             return 0xFF;
         }
-        case 0xC: {
-            return wram[address & (address & 0xFFF)];
-        }
-        case 0xD: {
-            return wram[(wram_bank_num * 0x1000) + (address & 0xFFF)];
-        }
-        case 0xE: {
-            return wram[address & (address & 0xFFF)];
-        }
         case 0xF: {
             auto hram_page = address >> 8;
 
             switch (hram_page) {
-            case 0xFD: {
-                return wram[address & 0x1FFF];
-            }
             case 0xFE: {
                 return core->ppu.read_oam(address & 0xFF);
             }
             case 0xFF: {
-                auto io_address = address & 0xFF;
-
-                switch (io_address) {
-                // Input
-                case 0x00: {
-                    return core->pad.get_pad_state();
-                }
-
-                // Serial Port
-                case 0x01:
-                case 0x02: {
-                    return 0xFF;
-                }
-
-                // Timer
-                case 0x04:
-                case 0x05:
-                case 0x06:
-                case 0x07: {
-                    return core->timer.read_register(io_address);
-                }
-
-                case 0x0F: {
-                    return core->cpu.interrupt_flag;
-                }
-
-                // APU
-                case 0x10:
-                case 0x11:
-                case 0x12:
-                case 0x13:
-                case 0x14:
-                case 0x15:
-                case 0x16:
-                case 0x17:
-                case 0x18:
-                case 0x19:
-                case 0x1A:
-                case 0x1B:
-                case 0x1C:
-                case 0x1D:
-                case 0x1E:
-                case 0x1F:
-                case 0x20:
-                case 0x21:
-                case 0x22:
-                case 0x23:
-                case 0x24:
-                case 0x25:
-                case 0x26:
-                case 0x27: {
-                    return core->apu.read_register(io_address);
-                }
-
-                // APU Wave RAM
-                case 0x30:
-                case 0x31:
-                case 0x32:
-                case 0x33:
-                case 0x34:
-                case 0x35:
-                case 0x36:
-                case 0x37:
-                case 0x38:
-                case 0x39:
-                case 0x3A:
-                case 0x3B:
-                case 0x3C:
-                case 0x3D:
-                case 0x3E:
-                case 0x3F: {
-                    return core->apu.read_wave_ram(io_address - 0x30);
-                }
-
-                // PPU Registers
-                case 0x40:
-                case 0x41:
-                case 0x42:
-                case 0x43:
-                case 0x44:
-                case 0x45:
-                case 0x46:
-                case 0x47:
-                case 0x48:
-                case 0x49:
-                case 0x4A:
-                case 0x4B:
-                case 0x4F:
-                case 0x68:
-                case 0x69:
-                case 0x6A:
-                case 0x6B:
-                case 0x6C: {
-                    return core->ppu.read_register(io_address);
-                }
-
-                case 0x4C: {
-                    return KEY0;
-                }
-                case 0x4D: {
-                    return is_compatibility_mode() ? 0xFF : core->cpu.KEY1;
-                }
-                case 0x50: {
-                    return bootstrap_mapped_;
-                }
-                case 0x55: {
-                    return core->dma.get_dma_status();
-                }
-                case 0x70: {
-                    return wram_bank_num;
-                }
-                }
-
                 if ((address >= 0xFF80) && (address <= 0xFFFE)) {
                     return hram[address - 0xFF80]; // High Ram
-                } else if (address == 0xFFFF) {
+                }
+
+                if (address == 0xFFFF) {
                     return core->cpu.interrupt_enable;
                 }
 
-                return 0xFF; // IO Registers
+                const IORegister &reg = io_registers[address & 0x7F];
+                return reg.read ? reg.read(*this, address & 0x7F) : 0xFF;
             }
             }
 
@@ -226,7 +300,7 @@ namespace GB {
         return 0;
     }
 
-    void MainBus::write(uint16_t address, uint8_t value) {
+    void MainBus::write_slow(uint16_t address, uint8_t value) {
         auto page = address >> 12;
 
         switch (page) {
@@ -238,18 +312,18 @@ namespace GB {
         case 0x5:
         case 0x6:
         case 0x7: {
-            if (bootstrap_mapped_) {
-                if ((address < 0x100) || (address > 0x1FF)) {
-                    return;
-                } else if (cart) {
-                    cart->write(address, value);
-                }
-            } else {
-                if (cart) {
-                    cart->write(address, value);
-                }
+            if (!cart || (bootstrap_mapped_ && ((address < 0x100) || (address > 0x1FF)))) {
+                return;
+            }
+
+            uint8_t windows = cart->write(address, value);
+            if (windows) {
+                remap_cartridge(windows);
             }
 
+            if (windows & (ROM0_WINDOW | ROMX_WINDOW)) {
+                core->cpu.rom_mapping_changed();
+            }
             return;
         }
 
@@ -267,180 +341,29 @@ namespace GB {
             return;
         }
 
-        case 0xC: {
-            wram[address & (address & 0xFFF)] = value;
-            return;
-        }
-        case 0xD: {
-            wram[(wram_bank_num * 0x1000) + (address & 0xFFF)] = value;
-            return;
-        }
-        case 0xE: {
-            wram[address & (address & 0xFFF)] = value;
-            return;
-        }
-
         case 0xF: {
             auto hram_page = address >> 8;
 
             switch (hram_page) {
-            case 0xFD: {
-                wram[address & 0x1FFF] = value;
-                return;
-            }
             case 0xFE: {
                 core->ppu.write_oam(address & 0xFF, value);
                 return;
             }
             case 0xFF: {
-                auto io_address = address & 0xFF;
-
-                switch (io_address) {
-                // Input
-                case 0x00: {
-                    core->pad.select_button_mode(value);
-                    return;
-                }
-
-                // Timer
-                case 0x04:
-                case 0x05:
-                case 0x06:
-                case 0x07: {
-                    core->timer.write_register(io_address, value);
-                    return;
-                }
-
-                case 0x0F: {
-                    core->cpu.interrupt_flag = value;
-                    return;
-                }
-
-                // APU
-                case 0x10:
-                case 0x11:
-                case 0x12:
-                case 0x13:
-                case 0x14:
-                case 0x15:
-                case 0x16:
-                case 0x17:
-                case 0x18:
-                case 0x19:
-                case 0x1A:
-                case 0x1B:
-                case 0x1C:
-                case 0x1D:
-                case 0x1E:
-                case 0x1F:
-                case 0x20:
-                case 0x21:
-                case 0x22:
-                case 0x23:
-                case 0x24:
-                case 0x25:
-                case 0x26:
-                case 0x27: {
-                    core->apu.write_register(io_address, value);
-                    return;
-                }
-
-                // APU Wave RAM
-                case 0x30:
-                case 0x31:
-                case 0x32:
-                case 0x33:
-                case 0x34:
-                case 0x35:
-                case 0x36:
-                case 0x37:
-                case 0x38:
-                case 0x39:
-                case 0x3A:
-                case 0x3B:
-                case 0x3C:
-                case 0x3D:
-                case 0x3E:
-                case 0x3F: {
-                    core->apu.write_wave_ram(io_address - 0x30, value);
-                    return;
-                }
-
-                // PPU Registers
-                case 0x40:
-                case 0x41:
-                case 0x42:
-                case 0x43:
-                case 0x45:
-                case 0x46:
-                case 0x47:
-                case 0x48:
-                case 0x49:
-                case 0x4A:
-                case 0x4B:
-                case 0x4F:
-                case 0x68:
-                case 0x69:
-                case 0x6A:
-                case 0x6B:
-                case 0x6C: {
-                    core->ppu.write_register(io_address, value);
-                    return;
-                }
-
-                case 0x4C: {
-                    if (bootstrap_mapped_) {
-                        KEY0 = value;
-                    }
-                    return;
-                }
-
-                case 0x4D: {
-                    core->cpu.KEY1 &= ~0x1;
-                    core->cpu.KEY1 |= value & 0x1;
-                    return;
-                }
-
-                case 0x50: {
-                    bootstrap_mapped_ = false;
-                    return;
-                }
-                case 0x51: {
-                    core->dma.set_hdma1(value);
-                    return;
-                }
-                case 0x52: {
-                    core->dma.set_hdma2(value);
-                    return;
-                }
-                case 0x53: {
-                    core->dma.set_hdma3(value);
-                    return;
-                }
-                case 0x54: {
-                    core->dma.set_hdma4(value);
-                    return;
-                }
-                case 0x55: {
-                    core->dma.set_dma_control(value);
-                    return;
-                }
-
-                case 0x70: {
-                    value &= 0x7;
-                    wram_bank_num = value ? value : 1;
-                    return;
-                }
-                }
-
                 if ((address >= 0xFF80) && (address <= 0xFFFE)) {
                     hram[address - 0xFF80] = value; // High Ram
                     return;
-                } else if (address == 0xFFFF) {
+                }
+
+                if (address == 0xFFFF) {
                     core->cpu.interrupt_enable = value;
                     return;
                 }
 
+                const IORegister &reg = io_registers[address & 0x7F];
+                if (reg.write) {
+                    reg.write(*this, address & 0x7F, value);
+                }
                 return;
             }
             }
@@ -24,6 +24,27 @@ namespace GB {
     class Cartridge;
     class Core;
 
+    // Reported by MainBus::rom_bank for addresses served by the bootstrap ROM.
+    constexpr int32_t BOOTSTRAP_ROM_BANK = -1;
+
+    // Side effects of accessing an IO register, as recorded in its IORegister entry. A SYNCS
+    // flag means the value depends on that component having caught up to the CPU.
+    constexpr uint8_t IO_SYNCS_PPU = 0x01;
+    constexpr uint8_t IO_SYNCS_APU = 0x02;
+    constexpr uint8_t IO_SYNCS_TIMER = 0x04;
+    constexpr uint8_t IO_SYNCS_SERIAL = 0x08;
+    constexpr uint8_t IO_SCHEDULES_EVENTS = 0x10; // Writes may change ticks_until_event().
+    constexpr uint8_t IO_REMAPS_MEMORY = 0x20;    // Writes rebuild the page table.
+
+    class MainBus;
+
+    // Handlers for one register in FF00-FF7F; a null handler reads 0xFF or ignores writes.
+    struct IORegister {
+        uint8_t (*read)(MainBus &bus, uint8_t io_address) = nullptr;
+        void (*write)(MainBus &bus, uint8_t io_address, uint8_t value) = nullptr;
+        uint8_t flags = 0;
+    };
+
     class MainBus {
     public:
         MainBus(Core *core);
@@ -33,10 +54,38 @@ namespace GB {
 
         void reset(Cartridge *new_cart);
 
-        uint8_t read(uint16_t address);
-        void write(uint16_t address, uint8_t value);
+        int32_t rom_bank(uint16_t address) const;
+
+        uint8_t read(uint16_t address) {
+            if (const uint8_t *page = read_pages[address >> 8]) {
+                return page[address & 0xFF];
+            }
+            return read_slow(address);
+        }
+
+        void write(uint16_t address, uint8_t value) {
+            if (uint8_t *page = write_pages[address >> 8]) {
+                page[address & 0xFF] = value;
+                return;
+            }
+            write_slow(address, value);
+        }
+
+        void unmap_bootstrap();
+        void remap_cartridge(uint8_t windows);
 
     private:
+        uint8_t read_slow(uint16_t address);
+        void write_slow(uint16_t address, uint8_t value);
+        void remap_wram();
+        void init_io_registers();
+
+        // Direct pointers to each 256-byte page of plain memory, null where the page needs
+        // side effects (IO, VRAM/OAM, MBC registers, RTC, disabled RAM or the boot ROM).
+        std::array<const uint8_t *, 256> read_pages{};
+        std::array<uint8_t *, 256> write_pages{};
+        std::array<IORegister, 128> io_registers{};
+
         bool bootstrap_mapped_ = true;
         uint8_t wram_bank_num = 1;
         uint8_t KEY0 = 0x0;
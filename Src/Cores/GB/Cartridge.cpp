@@ -18,6 +18,9 @@
 
 #include "Cartridge.hpp"
 #include "Constants.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <fstream>
 
 namespace GB {
@@ -25,6 +28,15 @@ namespace GB {
 
     const CartHeader &Cartridge::header() const { return header_; }
 
+    void Cartridge::set_clock(std::function<uint64_t()> clock) { this->clock = clock; }
+
+    uint64_t Cartridge::elapsed_cycles() const { return clock ? clock() : 0; }
+
+    const uint8_t *Cartridge::bank_data(const std::vector<uint8_t> &rom, int32_t bank) {
+        size_t offset = static_cast<size_t>(bank) * 0x4000;
+        return (offset + 0x4000) <= rom.size() ? rom.data() + offset : nullptr;
+    }
+
     std::unique_ptr<Cartridge> Cartridge::from_file(std::filesystem::path rom_path) {
         return std::unique_ptr<Cartridge>(from_file_raw_ptr(std::move(rom_path)));
     }
@@ -133,20 +145,24 @@ namespace GB {
                         static_cast<std::streamsize>(rom.size()));
     }
 
+    int32_t ROM::rom_bank(uint16_t address) const { return address >> 14; }
+
     uint8_t ROM::read(uint16_t address) { return rom[address]; }
 
-    void ROM::write(uint16_t address, uint8_t value) {}
+    uint8_t ROM::write(uint16_t, uint8_t) { return 0; }
 
     uint8_t ROM::read_ram(uint16_t address) { return 0xFF; }
 
     void ROM::write_ram(uint16_t address, uint8_t value) {}
 
+    const uint8_t *ROM::rom_window(uint16_t address) const {
+        return bank_data(rom, rom_bank(address));
+    }
+
     void ROM::save_sram_to_file() {}
 
     void ROM::load_sram_from_file() {}
 
-    void ROM::tick(int32_t cycles) {}
-
     MBC1::MBC1(CartHeader &&header) : Cartridge(std::move(header)), eram() { eram.fill(0); }
 
     bool MBC1::has_battery() const { return header_.mbc_type == 3; }
@@ -156,7 +172,11 @@ namespace GB {
         rom_bank_num = 1;
         bank_upper_bits = 0;
         ram_enabled = false;
-        eram.fill(0);
+
+        // Battery backed RAM keeps whatever load_sram_from_file() restored.
+        if (!has_battery()) {
+            eram.fill(0);
+        }
     }
 
     void MBC1::init_banks(std::ifstream &rom_stream) {
@@ -169,6 +189,16 @@ namespace GB {
         rom_stream.read(reinterpret_cast<char *>(rom.data()), rom_len);
     }
 
+    int32_t MBC1::rom_bank(uint16_t address) const {
+        int32_t bank_num = (bank_upper_bits << 5);
+
+        if (address < 0x4000) {
+            return mode ? bank_num % static_cast<int32_t>(rom.size() / 0x4000) : 0;
+        }
+
+        return (bank_num | rom_bank_num) % static_cast<int32_t>(rom.size() / 0x4000);
+    }
+
     uint8_t MBC1::read(uint16_t address) {
         int32_t bank_num = (bank_upper_bits << 5);
 
@@ -183,24 +213,32 @@ namespace GB {
         return rom[(bank_num * 0x4000) + (address & 0x3FFF)];
     }
 
-    void MBC1::write(uint16_t address, uint8_t value) {
+    uint8_t MBC1::write(uint16_t address, uint8_t value) {
         switch (address >> 12) {
         case 0x0:
         case 0x1: {
-            ram_enabled = (value & 0xF) == 0xA;
-            break;
+            bool enabled = (value & 0xF) == 0xA;
+            uint8_t changed = (enabled != ram_enabled) ? RAM_WINDOW : 0;
+
+            ram_enabled = enabled;
+            return changed;
         }
         case 0x2:
         case 0x3: {
-            rom_bank_num = value & 0x1F;
-            if (rom_bank_num == 0) {
-                rom_bank_num = 1;
+            int32_t bank = value & 0x1F;
+            if (bank == 0) {
+                bank = 1;
             }
-            break;
+
+            uint8_t changed = (bank != rom_bank_num) ? ROMX_WINDOW : 0;
+            rom_bank_num = bank;
+            return changed;
         }
 
         case 0x4:
         case 0x5: {
+            int32_t upper_bits = bank_upper_bits;
+
             if (mode) {
                 if (header_.ram_size == RamSize::Ram32KB) {
                     bank_upper_bits = value & 0x3;
@@ -210,15 +248,22 @@ namespace GB {
             if (header_.rom_size >= RomSize::Rom1MB) {
                 bank_upper_bits = (value & 0x3);
             }
-            break;
+
+            // The upper bits also select the bank at 0x0000 and the RAM bank in mode 1.
+            return (upper_bits != bank_upper_bits) ? ALL_WINDOWS : 0;
         }
 
         case 0x6:
         case 0x7: {
-            mode = value & 0x1;
-            break;
+            bool new_mode = value & 0x1;
+            uint8_t changed = (new_mode != mode) ? (ROM0_WINDOW | RAM_WINDOW) : 0;
+
+            mode = new_mode;
+            return changed;
         }
         }
+
+        return 0;
     }
 
     uint8_t MBC1::read_ram(uint16_t address) {
@@ -235,6 +280,18 @@ namespace GB {
         }
     }
 
+    const uint8_t *MBC1::rom_window(uint16_t address) const {
+        return bank_data(rom, rom_bank(address));
+    }
+
+    uint8_t *MBC1::ram_window() {
+        if (!ram_enabled) {
+            return nullptr;
+        }
+
+        return &eram[mode ? (bank_upper_bits * 0x2000) : 0];
+    }
+
     void MBC1::save_sram_to_file() {
         if (!has_battery()) {
             return;
@@ -261,17 +318,16 @@ namespace GB {
 
         std::ifstream sram(path, std::ios::binary | std::ios::ate);
         if (sram) {
-            auto len = sram.tellg();
+            auto len = static_cast<size_t>(sram.tellg());
 
             sram.seekg(0);
 
-            sram.read(reinterpret_cast<char *>(eram.data()), len);
+            sram.read(reinterpret_cast<char *>(eram.data()),
+                      static_cast<std::streamsize>(std::min(len, eram.size())));
             sram.close();
         }
     }
 
-    void MBC1::tick(int32_t cycles) {}
-
     MBC2::MBC2(CartHeader &&header) : Cartridge(std::move(header)) {}
 
     bool MBC2::has_battery() const { return header_.mbc_type == 6; }
@@ -279,7 +335,10 @@ namespace GB {
     void MBC2::reset() {
         rom_bank_num = 1;
         ram_enabled = false;
-        ram.fill(0);
+
+        if (!has_battery()) {
+            ram.fill(0);
+        }
     }
 
     void MBC2::init_banks(std::ifstream &rom_stream) {
@@ -292,6 +351,14 @@ namespace GB {
         rom_stream.read(reinterpret_cast<char *>(rom.data()), rom_len);
     }
 
+    int32_t MBC2::rom_bank(uint16_t address) const {
+        if (address < 0x4000) {
+            return 0;
+        }
+
+        return rom_bank_num % static_cast<int32_t>(rom.size() / 0x4000);
+    }
+
     uint8_t MBC2::read(uint16_t address) {
         if (address < 0x4000) {
             return rom[address];
@@ -302,20 +369,25 @@ namespace GB {
         return rom[(bank * 0x4000) + (address & 0x3FFF)];
     }
 
-    void MBC2::write(uint16_t address, uint8_t value) {
+    uint8_t MBC2::write(uint16_t address, uint8_t value) {
         if (address < 0x4000) {
             if (address & 0x100) {
+                uint16_t bank = value & 0xF;
 
-                rom_bank_num = value & 0xF;
-
-                if (rom_bank_num == 0) {
-                    rom_bank_num = 1;
+                if (bank == 0) {
+                    bank = 1;
                 }
+
+                uint8_t changed = (bank != rom_bank_num) ? ROMX_WINDOW : 0;
+                rom_bank_num = bank;
+                return changed;
             } else {
-                // ram enable
+                // ram enable, the nibble RAM is never mapped directly
                 ram_enabled = (value & 0xF) == 0xA;
             }
         }
+
+        return 0;
     }
 
     uint8_t MBC2::read_ram(uint16_t address) {
@@ -332,6 +404,10 @@ namespace GB {
         }
     }
 
+    const uint8_t *MBC2::rom_window(uint16_t address) const {
+        return bank_data(rom, rom_bank(address));
+    }
+
     void MBC2::save_sram_to_file() {
         if (!has_battery()) {
             return;
@@ -358,16 +434,63 @@ namespace GB {
 
         std::ifstream sram(path, std::ios::binary | std::ios::ate);
         if (sram) {
-            auto len = sram.tellg();
+            auto len = static_cast<size_t>(sram.tellg());
 
             sram.seekg(0);
 
-            sram.read(reinterpret_cast<char *>(ram.data()), len);
+            sram.read(reinterpret_cast<char *>(ram.data()),
+                      static_cast<std::streamsize>(std::min(len, ram.size())));
             sram.close();
         }
     }
 
-    void MBC2::tick(int32_t cycles) {}
+    /*
+        RTC carts append the clock to the .sram in the layout BGB and VBA-M use: the live and
+        latched registers as little-endian 32-bit seconds, minutes, hours, day low and day
+        high/control words, then the host UNIX time of the save as a 64-bit value.
+    */
+    constexpr size_t RTC_FOOTER_SIZE = 48;
+
+    static void store_le(uint8_t *out, uint64_t value, int32_t bytes) {
+        for (int32_t i = 0; i < bytes; ++i) {
+            out[i] = static_cast<uint8_t>(value >> (i * 8));
+        }
+    }
+
+    static uint64_t load_le(const uint8_t *in, int32_t bytes) {
+        uint64_t value = 0;
+
+        for (int32_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(in[i]) << (i * 8);
+        }
+
+        return value;
+    }
+
+    static void store_rtc(uint8_t *out, const RTCTimePoint &time, uint16_t ctrl) {
+        store_le(out, time.seconds.get(), 4);
+        store_le(out + 4, time.minutes.get(), 4);
+        store_le(out + 8, time.hours.get(), 4);
+        store_le(out + 12, time.days & 0xFF, 4);
+        store_le(out + 16, (ctrl & 0xC0) | ((time.days >> 8) & 0x1), 4);
+    }
+
+    // Returns the halt and day carry bits.
+    static uint16_t load_rtc(const uint8_t *in, RTCTimePoint &time) {
+        uint64_t day_high = load_le(in + 16, 4);
+
+        time.seconds.set(static_cast<uint8_t>(load_le(in, 4)));
+        time.minutes.set(static_cast<uint8_t>(load_le(in + 4, 4)));
+        time.hours.set(static_cast<uint8_t>(load_le(in + 8, 4)));
+        time.days = static_cast<uint16_t>((load_le(in + 12, 4) & 0xFF) | ((day_high & 0x1) << 8));
+
+        return static_cast<uint16_t>(day_high & 0xC0);
+    }
+
+    static int64_t host_time() {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::seconds>(now).count();
+    }
 
     RTCCounter::RTCCounter(uint8_t bit_mask) : mask(bit_mask) {}
 
@@ -383,6 +506,8 @@ namespace GB {
         counter &= mask;
     }
 
+    bool RTCCounter::valid(uint8_t limit) const { return counter < limit; }
+
     MBC3::MBC3(CartHeader &&header) : Cartridge(std::move(header)) {}
 
     bool MBC3::has_rtc() const {
@@ -411,12 +536,17 @@ namespace GB {
         rom_bank_num = 1;
         ram_rtc_select = 0;
         ram_rtc_enabled = false;
-        eram.fill(0);
         latch_byte = 0;
-        rtc_cycles = 0;
-        rtc = RTCTimePoint{};
-        shadow_rtc = RTCTimePoint{};
-        rtc_ctrl = 0;
+        rtc_timestamp = elapsed_cycles();
+
+        // Battery backed RAM and the clock keep whatever load_sram_from_file() restored.
+        if (!has_battery()) {
+            eram.fill(0);
+            rtc_cycles = 0;
+            rtc = RTCTimePoint{};
+            shadow_rtc = RTCTimePoint{};
+            rtc_ctrl = 0;
+        }
     }
 
     void MBC3::init_banks(std::ifstream &rom_stream) {
@@ -429,6 +559,8 @@ namespace GB {
         rom_stream.read(reinterpret_cast<char *>(rom.data()), rom_len);
     }
 
+    int32_t MBC3::rom_bank(uint16_t address) const { return address < 0x4000 ? 0 : rom_bank_num; }
+
     uint8_t MBC3::read(uint16_t address) {
         if (address < 0x4000) {
             return rom[address];
@@ -437,31 +569,40 @@ namespace GB {
         return rom[(rom_bank_num * 0x4000) + (address & 0x3FFF)];
     }
 
-    void MBC3::write(uint16_t address, uint8_t value) {
+    uint8_t MBC3::write(uint16_t address, uint8_t value) {
         switch (address >> 12) {
         case 0x0:
         case 0x1: {
-            ram_rtc_enabled = (value & 0xF) == 0xA;
-            break;
+            bool enabled = (value & 0xF) == 0xA;
+            uint8_t changed = (enabled != ram_rtc_enabled) ? RAM_WINDOW : 0;
+
+            ram_rtc_enabled = enabled;
+            return changed;
         }
         case 0x2:
         case 0x3: {
-            rom_bank_num = value; // MBC3 carts will access banks 1-7F, MBC30 1-FF
-            if (rom_bank_num == 0) {
-                rom_bank_num = 1;
+            int32_t bank = value; // MBC3 carts will access banks 1-7F, MBC30 1-FF
+            if (bank == 0) {
+                bank = 1;
             }
-            break;
+
+            uint8_t changed = (bank != rom_bank_num) ? ROMX_WINDOW : 0;
+            rom_bank_num = bank;
+            return changed;
         }
 
         case 0x4:
         case 0x5: {
+            uint8_t changed = (value != ram_rtc_select) ? RAM_WINDOW : 0;
+
             ram_rtc_select = value;
-            break;
+            return changed;
         }
 
         case 0x6:
         case 0x7: {
             if ((latch_byte == 0) && (value == 1)) {
+                update_rtc();
                 shadow_rtc = rtc;
             }
 
@@ -469,6 +610,8 @@ namespace GB {
             break;
         }
         }
+
+        return 0;
     }
 
     uint8_t MBC3::read_ram(uint16_t address) {
@@ -510,6 +653,10 @@ namespace GB {
     }
 
     void MBC3::write_ram(uint16_t address, uint8_t value) {
+        if (ram_rtc_select >= 0x8) {
+            update_rtc();
+        }
+
         switch (ram_rtc_select) {
         case 0x0:
         case 0x1:
@@ -552,6 +699,19 @@ namespace GB {
         }
     }
 
+    const uint8_t *MBC3::rom_window(uint16_t address) const {
+        return bank_data(rom, rom_bank(address));
+    }
+
+    uint8_t *MBC3::ram_window() {
+        // The RTC registers share this window and have to latch/update on access.
+        if (!ram_rtc_enabled || (ram_rtc_select > 0x7)) {
+            return nullptr;
+        }
+
+        return &eram[ram_rtc_select * 0x2000];
+    }
+
     void MBC3::save_sram_to_file() {
         if (!has_battery()) {
             return;
@@ -564,6 +724,19 @@ namespace GB {
         if (sram) {
             sram.write(reinterpret_cast<char *>(eram.data()),
                        static_cast<std::streamsize>(eram.size()));
+
+            if (has_rtc()) {
+                update_rtc();
+
+                std::array<uint8_t, RTC_FOOTER_SIZE> footer{};
+                store_rtc(footer.data(), rtc, rtc_ctrl);
+                store_rtc(footer.data() + 20, shadow_rtc, rtc_ctrl);
+                store_le(footer.data() + 40, static_cast<uint64_t>(host_time()), 8);
+
+                sram.write(reinterpret_cast<char *>(footer.data()),
+                           static_cast<std::streamsize>(footer.size()));
+            }
+
             sram.close();
         }
     }
@@ -578,40 +751,94 @@ namespace GB {
 
         std::ifstream sram(path, std::ios::binary | std::ios::ate);
         if (sram) {
-            auto len = sram.tellg();
+            auto len = static_cast<size_t>(sram.tellg());
 
             sram.seekg(0);
 
-            sram.read(reinterpret_cast<char *>(eram.data()), len);
+            sram.read(reinterpret_cast<char *>(eram.data()),
+                      static_cast<std::streamsize>(std::min(len, eram.size())));
+
+            std::array<uint8_t, RTC_FOOTER_SIZE> footer{};
+
+            if (has_rtc() && len >= eram.size() + footer.size()) {
+                sram.read(reinterpret_cast<char *>(footer.data()),
+                          static_cast<std::streamsize>(footer.size()));
+
+                rtc_ctrl = load_rtc(footer.data(), rtc);
+                load_rtc(footer.data() + 20, shadow_rtc);
+                rtc_cycles = 0;
+
+                // Catch up on the time that passed while the emulator was closed.
+                auto saved_at = static_cast<int64_t>(load_le(footer.data() + 40, 8));
+                auto now = host_time();
+
+                if (!(rtc_ctrl & 64) && now > saved_at) {
+                    advance_rtc(static_cast<uint64_t>(now - saved_at));
+                }
+            }
+
             sram.close();
         }
     }
 
-    void MBC3::tick(int32_t cycles) {
-        if (has_rtc() && !(rtc_ctrl & 64)) {
-            rtc_cycles += cycles;
+    void MBC3::update_rtc() {
+        uint64_t now = elapsed_cycles();
 
-            if (rtc_cycles == CPU_CLOCK_RATE) {
-                rtc_cycles = 0;
-                rtc.seconds.increment();
+        if (has_rtc() && !(rtc_ctrl & 64) && now > rtc_timestamp) {
+            uint64_t cycles = (now - rtc_timestamp) + rtc_cycles;
+
+            advance_rtc(cycles / CPU_CLOCK_RATE);
+            rtc_cycles = static_cast<int32_t>(cycles % CPU_CLOCK_RATE);
+        }
+
+        rtc_timestamp = now;
+    }
 
-                if (rtc.seconds.get() == 60) {
-                    rtc.seconds.set(0);
-                    rtc.minutes.increment();
+    void MBC3::advance_rtc(uint64_t seconds) {
+        // Out of range values count up to the register mask and wrap without a carry, so those
+        // have to be stepped a second at a time until every register is back in range.
+        while (seconds &&
+               !(rtc.seconds.valid(60) && rtc.minutes.valid(60) && rtc.hours.valid(24))) {
+            tick_rtc_second();
+            seconds--;
+        }
+
+        if (seconds == 0) {
+            return;
+        }
+
+        uint64_t total = rtc.seconds.get() + (rtc.minutes.get() * 60ull) +
+                         (rtc.hours.get() * 3600ull) + (rtc.days * 86400ull) + seconds;
+        uint64_t days = total / 86400;
+
+        rtc.seconds.set(static_cast<uint8_t>(total % 60));
+        rtc.minutes.set(static_cast<uint8_t>((total / 60) % 60));
+        rtc.hours.set(static_cast<uint8_t>((total / 3600) % 24));
+        rtc.days = static_cast<uint16_t>(days % 512);
+
+        if (days >= 512) {
+            rtc_ctrl |= 128;
+        }
+    }
 
-                    if (rtc.minutes.get() == 60) {
-                        rtc.minutes.set(0);
-                        rtc.hours.increment();
+    void MBC3::tick_rtc_second() {
+        rtc.seconds.increment();
 
-                        if (rtc.hours.get() == 24) {
-                            rtc.hours.set(0);
-                            rtc.days++;
+        if (rtc.seconds.get() == 60) {
+            rtc.seconds.set(0);
+            rtc.minutes.increment();
 
-                            if (rtc.days == 512) {
-                                rtc.days = 0;
-                                rtc_ctrl |= 128;
-                            }
-                        }
+            if (rtc.minutes.get() == 60) {
+                rtc.minutes.set(0);
+                rtc.hours.increment();
+
+                if (rtc.hours.get() == 24) {
+                    rtc.hours.set(0);
+                    rtc.days++;
+
+                    if (rtc.days == 512) {
+                        rtc.days = 0;
+                        rtc_ctrl |= 128;
                     }
                 }
             }
@@ -636,7 +863,10 @@ namespace GB {
         bank_upper_bits = 0;
         ram_bank_num = 0;
         ram_enabled = false;
-        eram.fill(0);
+
+        if (!has_battery()) {
+            eram.fill(0);
+        }
     }
 
     void MBC5::init_banks(std::ifstream &rom_stream) {
@@ -649,6 +879,14 @@ namespace GB {
         rom_stream.read(reinterpret_cast<char *>(rom.data()), rom_len);
     }
 
+    int32_t MBC5::rom_bank(uint16_t address) const {
+        if (address < 0x4000) {
+            return 0;
+        }
+
+        return (rom_bank_num | bank_upper_bits) % static_cast<int32_t>(rom.size() / 0x4000);
+    }
+
     uint8_t MBC5::read(uint16_t address) {
         int32_t bank_num = rom_bank_num | bank_upper_bits;
 
@@ -661,28 +899,41 @@ namespace GB {
         return rom[(bank_num * 0x4000) + (address & 0x3FFF)];
     }
 
-    void MBC5::write(uint16_t address, uint8_t value) {
+    uint8_t MBC5::write(uint16_t address, uint8_t value) {
         switch (address >> 12) {
         case 0x0:
         case 0x1: {
-            ram_enabled = (value & 0xF) == 0xA;
-            break;
+            bool enabled = (value & 0xF) == 0xA;
+            uint8_t changed = (enabled != ram_enabled) ? RAM_WINDOW : 0;
+
+            ram_enabled = enabled;
+            return changed;
         }
         case 0x2: {
+            uint8_t changed = (value != rom_bank_num) ? ROMX_WINDOW : 0;
+
             rom_bank_num = value;
-            break;
+            return changed;
         }
         case 0x3: {
-            bank_upper_bits = (value & 0x1) << 8;
-            break;
+            int32_t upper_bits = (value & 0x1) << 8;
+            uint8_t changed = (upper_bits != bank_upper_bits) ? ROMX_WINDOW : 0;
+
+            bank_upper_bits = upper_bits;
+            return changed;
         }
 
         case 0x4:
         case 0x5: {
-            ram_bank_num = value & 0xF;
-            break;
+            int32_t bank = value & 0xF;
+            uint8_t changed = (bank != ram_bank_num) ? RAM_WINDOW : 0;
+
+            ram_bank_num = bank;
+            return changed;
         }
         }
+
+        return 0;
     }
 
     uint8_t MBC5::read_ram(uint16_t address) {
@@ -699,6 +950,18 @@ namespace GB {
         }
     }
 
+    const uint8_t *MBC5::rom_window(uint16_t address) const {
+        return bank_data(rom, rom_bank(address));
+    }
+
+    uint8_t *MBC5::ram_window() {
+        if (!ram_enabled) {
+            return nullptr;
+        }
+
+        return &eram[ram_bank_num * 0x2000];
+    }
+
     void MBC5::save_sram_to_file() {
         if (!has_battery()) {
             return;
@@ -725,14 +988,14 @@ namespace GB {
 
         std::ifstream sram(path, std::ios::binary | std::ios::ate);
         if (sram) {
-            auto len = sram.tellg();
+            auto len = static_cast<size_t>(sram.tellg());
 
             sram.seekg(0);
 
-            sram.read(reinterpret_cast<char *>(eram.data()), len);
+            sram.read(reinterpret_cast<char *>(eram.data()),
+                      static_cast<std::streamsize>(std::min(len, eram.size())));
             sram.close();
         }
     }
 
-    void MBC5::tick(int32_t cycles) {}
 }
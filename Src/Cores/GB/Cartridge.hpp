@@ -20,6 +20,7 @@
 #include <array>
 #include <cinttypes>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -67,6 +68,12 @@ namespace GB {
         RamSize ram_size = RamSize::NoRam;
     };
 
+    // Address windows whose mapping a write to the MBC registers can change.
+    constexpr uint8_t ROM0_WINDOW = 0x01; // 0x0000-0x3FFF
+    constexpr uint8_t ROMX_WINDOW = 0x02; // 0x4000-0x7FFF
+    constexpr uint8_t RAM_WINDOW = 0x04;  // 0xA000-0xBFFF
+    constexpr uint8_t ALL_WINDOWS = ROM0_WINDOW | ROMX_WINDOW | RAM_WINDOW;
+
     class Cartridge {
     public:
         explicit Cartridge(CartHeader &&header);
@@ -83,20 +90,35 @@ namespace GB {
 
         virtual void init_banks(std::ifstream &rom_stream) = 0;
 
+        // Bank currently mapped at a ROM address (0x0000-0x7FFF).
+        virtual int32_t rom_bank(uint16_t address) const = 0;
+
         virtual uint8_t read(uint16_t address) = 0;
-        virtual void write(uint16_t address, uint8_t value) = 0;
+        // Returns the windows whose mapping changed, see ROM0_WINDOW and friends.
+        virtual uint8_t write(uint16_t address, uint8_t value) = 0;
         virtual uint8_t read_ram(uint16_t address) = 0;
         virtual void write_ram(uint16_t address, uint8_t value) = 0;
 
+        // Memory currently mapped at the 16KB ROM window holding address or at the 8KB RAM
+        // window, or null when accesses to it must go through read()/read_ram() and friends.
+        virtual const uint8_t *rom_window(uint16_t address) const = 0;
+        virtual uint8_t *ram_window() { return nullptr; }
+
         virtual void save_sram_to_file() = 0;
         virtual void load_sram_from_file() = 0;
-        virtual void tick(int32_t cycles) = 0;
+
+        // Source of the master clock, which runs at CPU_CLOCK_RATE ticks per second.
+        void set_clock(std::function<uint64_t()> clock);
 
         static std::unique_ptr<Cartridge> from_file(std::filesystem::path rom_path);
         static Cartridge *from_file_raw_ptr(std::filesystem::path rom_path);
 
     protected:
+        uint64_t elapsed_cycles() const;
+        static const uint8_t *bank_data(const std::vector<uint8_t> &rom, int32_t bank);
+
         CartHeader header_;
+        std::function<uint64_t()> clock = nullptr;
     };
 
     class ROM : public Cartridge {
@@ -113,14 +135,15 @@ namespace GB {
         void reset() override;
         void init_banks(std::ifstream &rom_stream) override;
 
+        int32_t rom_bank(uint16_t address) const override;
         uint8_t read(uint16_t address) override;
-        void write(uint16_t address, uint8_t value) override;
+        uint8_t write(uint16_t address, uint8_t value) override;
         uint8_t read_ram(uint16_t address) override;
         void write_ram(uint16_t address, uint8_t value) override;
+        const uint8_t *rom_window(uint16_t address) const override;
 
         void save_sram_to_file() override;
         void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
 
     private:
         std::vector<uint8_t> rom;
@@ -140,14 +163,16 @@ namespace GB {
         void reset() override;
         void init_banks(std::ifstream &rom_stream) override;
 
+        int32_t rom_bank(uint16_t addr) const override;
         uint8_t read(uint16_t addr) override;
-        void write(uint16_t addr, uint8_t value) override;
+        uint8_t write(uint16_t addr, uint8_t value) override;
         uint8_t read_ram(uint16_t addr) override;
         void write_ram(uint16_t addr, uint8_t value) override;
+        const uint8_t *rom_window(uint16_t address) const override;
+        uint8_t *ram_window() override;
 
         void save_sram_to_file() override;
         void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
 
     private:
         bool mode = 0;
@@ -173,14 +198,15 @@ namespace GB {
         void reset() override;
         void init_banks(std::ifstream &rom_stream) override;
 
+        int32_t rom_bank(uint16_t address) const override;
         uint8_t read(uint16_t address) override;
-        void write(uint16_t address, uint8_t value) override;
+        uint8_t write(uint16_t address, uint8_t value) override;
         uint8_t read_ram(uint16_t address) override;
         void write_ram(uint16_t address, uint8_t value) override;
+        const uint8_t *rom_window(uint16_t address) const override;
 
         void save_sram_to_file() override;
         void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
 
     private:
         uint16_t rom_bank_num = 1;
@@ -197,6 +223,7 @@ namespace GB {
 
         void set(uint8_t value);
         void increment();
+        bool valid(uint8_t limit) const;
 
     private:
         uint8_t counter = 0;
@@ -225,16 +252,22 @@ namespace GB {
         void reset() override;
         void init_banks(std::ifstream &rom_stream) override;
 
+        int32_t rom_bank(uint16_t addr) const override;
         uint8_t read(uint16_t addr) override;
-        void write(uint16_t addr, uint8_t value) override;
+        uint8_t write(uint16_t addr, uint8_t value) override;
         uint8_t read_ram(uint16_t addr) override;
         void write_ram(uint16_t addr, uint8_t value) override;
+        const uint8_t *rom_window(uint16_t address) const override;
+        uint8_t *ram_window() override;
 
         void save_sram_to_file() override;
         void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
 
     private:
+        void update_rtc();
+        void advance_rtc(uint64_t seconds);
+        void tick_rtc_second();
+
         int32_t rom_bank_num = 1;
         int32_t ram_rtc_select = 0;
 
@@ -244,6 +277,9 @@ namespace GB {
 
         uint8_t latch_byte = 0;
 
+        // Master clock at which rtc was last brought up to date, plus the part of a second
+        // that had already passed at that point.
+        uint64_t rtc_timestamp = 0;
         int32_t rtc_cycles = 0;
         RTCTimePoint rtc{}, shadow_rtc{};
         uint16_t rtc_ctrl = 0;
@@ -263,14 +299,16 @@ namespace GB {
         void reset() override;
         void init_banks(std::ifstream &rom_stream) override;
 
+        int32_t rom_bank(uint16_t addr) const override;
         uint8_t read(uint16_t addr) override;
-        void write(uint16_t addr, uint8_t value) override;
+        uint8_t write(uint16_t addr, uint8_t value) override;
         uint8_t read_ram(uint16_t addr) override;
         void write_ram(uint16_t addr, uint8_t value) override;
+        const uint8_t *rom_window(uint16_t address) const override;
+        uint8_t *ram_window() override;
 
         void save_sram_to_file() override;
         void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
 
     private:
         int32_t rom_bank_num = 1;
@@ -39,6 +39,12 @@ namespace GB {
         AutoSelect,
     };
 
+    enum class ColorCorrection {
+        Raw,
+        GBCLCD,
+        Gamma,
+    };
+
     consteval uint16_t RGB555ToUInt(uint16_t r, uint16_t g, uint16_t b) {
         r &= 0x1F;
         g &= 0x1F;
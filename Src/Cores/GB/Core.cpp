@@ -19,10 +19,11 @@
 #include "Core.hpp"
 #include "Constants.hpp"
 #include "PPU.hpp"
+#include <algorithm>
 #include <fstream>
 
 namespace GB {
-    Core::Core() : bus(this), ppu(this), timer(this), cpu(this), dma(this) {}
+    Core::Core() : bus(this), ppu(this), apu(this), timer(this), serial(this), cpu(this), dma(this) {}
 
     void Core::initialize(Cartridge *cart) {
         ready_to_run = cart ? true : false;
@@ -30,11 +31,14 @@ namespace GB {
             return;
         }
 
+        cart->set_clock([this] { return elapsed_cycles_; });
         cart->reset();
         bootstrap.clear();
+        scheduler.reset();
         apu.reset();
         ppu.reset();
         timer.reset();
+        serial.reset();
         pad.reset();
         bus.reset(cart);
         dma.reset();
@@ -53,7 +57,8 @@ namespace GB {
                 ppu.set_compatibility_palette(PaletteID::OBJ2, LCD_GRAY);
             }
 
-            bus.bootstrap_mapped_ = false;
+            ppu.set_compatibility_mode(bus.is_compatibility_mode());
+            bus.unmap_bootstrap();
 
             cpu.reset(0x0100);
             ppu.set_post_boot_state();
@@ -68,11 +73,14 @@ namespace GB {
             return;
         }
 
+        cart->set_clock([this] { return elapsed_cycles_; });
         cart->reset();
         bootstrap.clear();
+        scheduler.reset();
         apu.reset();
         ppu.reset();
         timer.reset();
+        serial.reset();
         pad.reset();
         bus.reset(cart);
         dma.reset();
@@ -89,36 +97,126 @@ namespace GB {
                 ppu.set_compatibility_palette(PaletteID::OBJ2, LCD_GRAY);
             }
 
+            ppu.set_compatibility_mode(bus.is_compatibility_mode());
             cpu.reset(0x0);
         }
     }
 
     void Core::run_for_frames(int32_t frames) {
         while (frames-- && ready_to_run) {
-            while (cycle_count < CYCLES_PER_FRAME && !cpu.stopped()) {
-                dma.tick();
-                cpu.step();
+            while (frame_in_progress()) {
+                GB_PROFILE(profile_, ProfileComponent::DMA, dma.tick());
+                GB_PROFILE(profile_, ProfileComponent::CPU, cpu.step());
             }
 
+            GB_PROFILE(profile_, ProfileComponent::PPU, ppu.sync());
+            GB_PROFILE(profile_, ProfileComponent::APU, apu.sync());
+
             if (cycle_count >= CYCLES_PER_FRAME) {
                 cycle_count -= CYCLES_PER_FRAME;
             }
+#ifdef GB_ENABLE_PROFILER
+            profile_.frames_++;
+#endif
         }
     }
 
+    bool Core::frame_in_progress() const {
+        return cycle_count < CYCLES_PER_FRAME && !cpu.stopped();
+    }
+
     void Core::tick_subcomponents(int32_t cycles) {
         int32_t adjusted_cycles = cpu.double_speed() ? 2 : 4;
 
         while (cycles > 0) {
-            timer.update(4);
-            ppu.step(adjusted_cycles);
-            apu.step(adjusted_cycles);
-            bus.cart->tick(adjusted_cycles);
             cycle_count += adjusted_cycles;
+            elapsed_cycles_ += adjusted_cycles;
             cycles -= 4;
+
+            if (elapsed_cycles_ >= scheduler.next_deadline()) {
+                run_due_events();
+            }
+        }
+    }
+
+    void Core::run_due_events() {
+        EventType type;
+
+        while (scheduler.pop_due(elapsed_cycles_, type)) {
+            switch (type) {
+            case EventType::SerialTransfer: {
+                GB_PROFILE(profile_, ProfileComponent::Serial, serial.complete_transfer());
+                break;
+            }
+            case EventType::Timer: {
+                GB_PROFILE(profile_, ProfileComponent::Timer, timer.sync());
+                timer.schedule_next_event();
+                break;
+            }
+            case EventType::PPU: {
+                GB_PROFILE(profile_, ProfileComponent::PPU, ppu.sync());
+                ppu.schedule_next_event();
+                break;
+            }
+            case EventType::Count: {
+                break;
+            }
+            }
         }
     }
 
+    /*
+        Number of tick_subcomponents(4) calls that can be made before anything happens that the
+        CPU or another component could observe: an interrupt, a frame sequencer step, the end of
+        the frame, a scheduled event or an HDMA transfer.
+    */
+    int32_t Core::ticks_until_event() {
+        if (dma.is_active()) {
+            return 0;
+        }
+
+        GB_PROFILE(profile_, ProfileComponent::PPU, ppu.sync());
+
+        int32_t adjusted_cycles = cpu.double_speed() ? 2 : 4;
+        int32_t frame_ticks = (CYCLES_PER_FRAME - cycle_count + adjusted_cycles - 1) /
+                              adjusted_cycles;
+        uint64_t scheduled_ticks = (scheduler.next_deadline() - elapsed_cycles_ - 1) /
+                                   adjusted_cycles;
+        int32_t ticks = std::min(frame_ticks, (ppu.cycles_until_event() - 1) / adjusted_cycles);
+
+        ticks = std::max(ticks, 0);
+
+        return static_cast<int32_t>(std::min<uint64_t>(ticks, scheduled_ticks));
+    }
+
+    /*
+        Number of tick_subcomponents(4) calls that run no scheduled event and end no later than
+        the end of the frame. Code that only touches CPU registers observes nothing else, so
+        such a span can be fast-forwarded without the PPU bound ticks_until_event() applies.
+    */
+    int32_t Core::ticks_until_deadline() const {
+        uint64_t deadline = scheduler.next_deadline();
+
+        if (dma.is_active() || deadline <= elapsed_cycles_) {
+            return 0;
+        }
+
+        int32_t adjusted_cycles = cpu.double_speed() ? 2 : 4;
+        int32_t frame_ticks = std::max((CYCLES_PER_FRAME - cycle_count) / adjusted_cycles, 0);
+        uint64_t scheduled_ticks = (deadline - elapsed_cycles_ - 1) / adjusted_cycles;
+
+        return static_cast<int32_t>(std::min<uint64_t>(frame_ticks, scheduled_ticks));
+    }
+
+    // Same as tick_subcomponents(ticks * 4) for spans no longer than ticks_until_event() or
+    // ticks_until_deadline().
+    void Core::fast_forward(int32_t ticks) {
+        int32_t adjusted_cycles = (cpu.double_speed() ? 2 : 4) * ticks;
+
+        cycle_count += adjusted_cycles;
+        elapsed_cycles_ += adjusted_cycles;
+    }
+
     void Core::load_bootstrap(std::filesystem::path path) {
         std::ifstream rom(path, std::ios::binary | std::ios::ate);
 
@@ -139,4 +237,10 @@ namespace GB {
     }
 
     uint8_t Core::read_bootstrap(uint16_t address) { return bootstrap[address]; }
+
+    uint64_t Core::elapsed_cycles() const { return elapsed_cycles_; }
+
+    const CoreProfile &Core::profile() const { return profile_; }
+
+    void Core::reset_profile() { profile_.reset(); }
 }
\ No newline at end of file
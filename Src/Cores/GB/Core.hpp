@@ -23,7 +23,10 @@
 #include "DMA.hpp"
 #include "PPU.hpp"
 #include "Pad.hpp"
+#include "Profiler.hpp"
 #include "SM83.hpp"
+#include "Scheduler.hpp"
+#include "Serial.hpp"
 #include "Timer.hpp"
 #include <cinttypes>
 #include <filesystem>
@@ -33,10 +36,12 @@ namespace GB {
     class Core {
     public:
         Gamepad pad;
+        Scheduler scheduler;
         MainBus bus;
         PPU ppu;
         APU apu;
         Timer timer;
+        Serial serial;
         SM83 cpu;
         DMAController dma;
         Core();
@@ -45,14 +50,27 @@ namespace GB {
         void initialize_with_bootstrap(Cartridge *cart, ConsoleType console,
                                        std::filesystem::path bootstrap_path);
         void run_for_frames(int32_t frames);
+        bool frame_in_progress() const;
         void tick_subcomponents(int32_t cycles);
+        int32_t ticks_until_event();
+        int32_t ticks_until_deadline() const;
+        void fast_forward(int32_t ticks);
         void load_bootstrap(std::filesystem::path path);
 
         uint8_t read_bootstrap(uint16_t address);
+        uint64_t elapsed_cycles() const;
+
+        const CoreProfile &profile() const;
+        void reset_profile();
 
     private:
         bool ready_to_run = false;
+        void run_due_events();
+
         int32_t cycle_count = 0;
+        // Master clock in PPU dots (2 per M-cycle in double speed, 4 otherwise).
+        uint64_t elapsed_cycles_ = 0;
         std::vector<uint8_t> bootstrap{};
+        CoreProfile profile_{};
     };
 }
\ No newline at end of file
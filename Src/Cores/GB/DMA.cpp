@@ -28,6 +28,8 @@ namespace GB {
         }
     }
 
+    bool DMAController::is_active() const { return active; }
+
     uint8_t DMAController::get_hdma1() const { return src_address >> 8; }
 
     uint8_t DMAController::get_hdma2() const { return src_address & 0xFF; }
@@ -50,6 +52,7 @@ namespace GB {
             type = (ctrl & 0x80) ? DMAType::HDMA : DMAType::GDMA;
             current_length = ctrl & 0x7F;
             active = true;
+            is_mode0 = (core->ppu.read_register(0x41) & 0x3) == HBLANK;
         } else {
             active = ctrl & 0x80;
         }
@@ -82,33 +85,36 @@ namespace GB {
     }
 
     void DMAController::tick() {
+        // Reading STAT syncs the PPU, so only look at it while a transfer is pending.
+        if (!active) {
+            return;
+        }
+
         bool mode0_now = (core->ppu.read_register(0x41) & 0x3) == HBLANK;
 
-        if (active) {
-            switch (type) {
-            case DMAType::GDMA: {
+        switch (type) {
+        case DMAType::GDMA: {
 
-                for (int i = 0; i < (current_length + 1); ++i) {
-                    transfer_block();
-                }
-                current_length = 0x7F;
-                active = false;
-                break;
+            for (int i = 0; i < (current_length + 1); ++i) {
+                transfer_block();
             }
-            case DMAType::HDMA: {
-                if (!is_mode0 && mode0_now) {
-                    transfer_block();
-
-                    if (current_length) {
-                        current_length--;
-                    } else {
-                        current_length = 0x7F;
-                        active = false;
-                    }
+            current_length = 0x7F;
+            active = false;
+            break;
+        }
+        case DMAType::HDMA: {
+            if (!is_mode0 && mode0_now) {
+                transfer_block();
+
+                if (current_length) {
+                    current_length--;
+                } else {
+                    current_length = 0x7F;
+                    active = false;
                 }
-                break;
-            }
             }
+            break;
+        }
         }
 
         is_mode0 = mode0_now;
@@ -28,6 +28,7 @@ namespace GB {
     public:
         DMAController(Core *core);
 
+        bool is_active() const;
         uint8_t get_dma_status() const;
         uint8_t get_hdma1() const;
         uint8_t get_hdma2() const;
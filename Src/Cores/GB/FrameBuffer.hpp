@@ -0,0 +1,69 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Constants.hpp"
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <span>
+
+namespace GB {
+    /*
+        Three frame images shared between the thread running the core and one reader. The PPU
+        draws into the back image and publishes it by swapping indices, the reader takes the
+        newest published image without either side copying or blocking.
+    */
+    class FrameBuffer {
+    public:
+        using Image = std::array<uint8_t, LCD_WIDTH * LCD_HEIGHT * FRAMEBUFFER_COLOR_CHANNELS>;
+
+        // Writer side, the image being drawn.
+        Image &back() { return images[back_index]; }
+
+        // Hands the back image to the reader, of which the first size bytes were drawn.
+        void publish(size_t size) {
+            sizes[back_index] = size;
+            back_index = ready_index.exchange(back_index | FRESH_BIT, std::memory_order_acq_rel);
+            back_index &= ~FRESH_BIT;
+        }
+
+        // Reader side, the drawn part of the newest published image. Stays valid until the next
+        // call.
+        std::span<uint8_t> front() {
+            if (ready_index.load(std::memory_order_relaxed) & FRESH_BIT) {
+                front_index = ready_index.exchange(front_index, std::memory_order_acq_rel);
+                front_index &= ~FRESH_BIT;
+            }
+
+            return {images[front_index].data(), sizes[front_index]};
+        }
+
+    private:
+        // Set on the ready index when it holds an image the reader has not taken yet.
+        static constexpr uint8_t FRESH_BIT = 0x4;
+
+        uint8_t back_index = 0;
+        std::atomic_uint8_t ready_index = 1;
+        uint8_t front_index = 2;
+
+        std::array<Image, 3> images{};
+        std::array<size_t, 3> sizes{sizeof(Image), sizeof(Image), sizeof(Image)};
+    };
+}
@@ -0,0 +1,486 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Jit.hpp"
+#include <array>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace GB {
+    namespace {
+        constexpr size_t CODE_CHUNK_SIZE = 256 * 1024;
+
+        uint8_t *map_chunk() {
+#ifdef _WIN32
+            void *memory =
+                VirtualAlloc(nullptr, CODE_CHUNK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+            return static_cast<uint8_t *>(memory);
+#else
+            void *memory = mmap(nullptr, CODE_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            return memory == MAP_FAILED ? nullptr : static_cast<uint8_t *>(memory);
+#endif
+        }
+
+        void unmap_chunk(uint8_t *memory) {
+#ifdef _WIN32
+            VirtualFree(memory, 0, MEM_RELEASE);
+#else
+            munmap(memory, CODE_CHUNK_SIZE);
+#endif
+        }
+
+        // Chunks stay executable except for the moment a new block is copied into them.
+        void set_writable(uint8_t *memory, bool writable) {
+#ifdef _WIN32
+            DWORD old_protect;
+            VirtualProtect(memory, CODE_CHUNK_SIZE, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ,
+                           &old_protect);
+            if (!writable) {
+                FlushInstructionCache(GetCurrentProcess(), memory, CODE_CHUNK_SIZE);
+            }
+#else
+            mprotect(memory, CODE_CHUNK_SIZE,
+                     writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC);
+#endif
+        }
+
+        // x86 register numbers used in ModRM fields.
+        constexpr uint8_t EAX = 0;
+        constexpr uint8_t ECX = 1;
+        constexpr uint8_t EDX = 2;
+
+        // Condition codes for emit_jump.
+        constexpr uint8_t JUMP_ALWAYS = 0;
+        constexpr uint8_t JUMP_IF_ZERO = 0x84;
+
+        void emit(std::vector<uint8_t> &code, std::initializer_list<uint8_t> bytes) {
+            for (uint8_t byte : bytes) {
+                code.push_back(byte);
+            }
+        }
+
+        void emit_uint16(std::vector<uint8_t> &code, uint16_t value) {
+            code.push_back(static_cast<uint8_t>(value));
+            code.push_back(static_cast<uint8_t>(value >> 8));
+        }
+
+        void emit_uint32(std::vector<uint8_t> &code, uint32_t value) {
+            for (int i = 0; i < 4; ++i) {
+                code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+            }
+        }
+
+        void emit_uint64(std::vector<uint8_t> &code, const void *pointer) {
+            auto value = reinterpret_cast<uintptr_t>(pointer);
+
+            for (int i = 0; i < 8; ++i) {
+                code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+            }
+        }
+
+        // ModRM and displacement for [rbx + offset], rbx holding the SM83 pointer.
+        void emit_cpu_operand(std::vector<uint8_t> &code, uint8_t reg, int32_t offset) {
+            code.push_back(static_cast<uint8_t>(0x83 | (reg << 3)));
+            emit_uint32(code, static_cast<uint32_t>(offset));
+        }
+
+        // movzx reg, byte [rbx + offset]
+        void load_byte(std::vector<uint8_t> &code, uint8_t reg, int32_t offset) {
+            emit(code, {0x0F, 0xB6});
+            emit_cpu_operand(code, reg, offset);
+        }
+
+        // movzx reg, word [rbx + offset]
+        void load_word(std::vector<uint8_t> &code, uint8_t reg, int32_t offset) {
+            emit(code, {0x0F, 0xB7});
+            emit_cpu_operand(code, reg, offset);
+        }
+
+        // mov byte [rbx + offset], reg
+        void store_byte(std::vector<uint8_t> &code, uint8_t reg, int32_t offset) {
+            code.push_back(0x88);
+            emit_cpu_operand(code, reg, offset);
+        }
+
+        // mov byte [rbx + offset], value
+        void store_byte_immediate(std::vector<uint8_t> &code, int32_t offset, uint8_t value) {
+            code.push_back(0xC6);
+            emit_cpu_operand(code, 0, offset);
+            code.push_back(value);
+        }
+
+        // mov word [rbx + offset], reg
+        void store_word(std::vector<uint8_t> &code, uint8_t reg, int32_t offset) {
+            emit(code, {0x66, 0x89});
+            emit_cpu_operand(code, reg, offset);
+        }
+
+        // mov word [rbx + offset], value
+        void store_word_immediate(std::vector<uint8_t> &code, int32_t offset, uint16_t value) {
+            emit(code, {0x66, 0xC7});
+            emit_cpu_operand(code, 0, offset);
+            emit_uint16(code, value);
+        }
+    }
+
+    JitCompiler::JitCompiler(NativeStep step, NativeEnter enter, const JitLayout &layout)
+        : step(step), enter(enter), layout(layout) {
+        if (!step || !enter) {
+            throw std::invalid_argument("Step and enter functions cannot be null.");
+        }
+    }
+
+    JitCompiler::~JitCompiler() { clear(); }
+
+    NativeBlock JitCompiler::compile(const DecodedBlock &block) {
+        // The first instruction has already run by the time the native code is entered.
+        if (block.instructions.size() < 2) {
+            return nullptr;
+        }
+
+        exit_jumps.clear();
+        code.clear();
+
+        // push rbx; mov rbx, <cpu argument>
+#ifdef _WIN32
+        emit(code, {0x53, 0x48, 0x89, 0xCB});
+        // sub rsp, 32 (shadow space)
+        emit(code, {0x48, 0x83, 0xEC, 0x20});
+#else
+        emit(code, {0x53, 0x48, 0x89, 0xFB});
+#endif
+
+        size_t i = 1;
+
+        while (i < block.instructions.size()) {
+            const DecodedInstruction &first = block.instructions[i];
+            size_t end = i;
+            int32_t ticks = 0;
+
+            while (end < block.instructions.size()) {
+                int32_t instruction_ticks = translated_ticks(block.instructions[end].bytes[0]);
+
+                if (!instruction_ticks) {
+                    break;
+                }
+
+                ticks += instruction_ticks;
+                ++end;
+            }
+
+            if (end == i) {
+                emit_step(first);
+                ++i;
+                continue;
+            }
+
+            auto count = static_cast<uint32_t>(end - i);
+#ifdef _WIN32
+            // mov rcx, rbx; mov rdx, <first>; mov r8d, <count>; mov r9d, <ticks>
+            emit(code, {0x48, 0x89, 0xD9, 0x48, 0xBA});
+            emit_uint64(code, &first);
+            emit(code, {0x41, 0xB8});
+            emit_uint32(code, count);
+            emit(code, {0x41, 0xB9});
+#else
+            // mov rdi, rbx; mov rsi, <first>; mov edx, <count>; mov ecx, <ticks>
+            emit(code, {0x48, 0x89, 0xDF, 0x48, 0xBE});
+            emit_uint64(code, &first);
+            code.push_back(0xBA);
+            emit_uint32(code, count);
+            code.push_back(0xB9);
+#endif
+            emit_uint32(code, static_cast<uint32_t>(ticks));
+            emit_call(reinterpret_cast<const void *>(enter));
+
+            // test al, al; jz <stepped copy>
+            emit(code, {0x84, 0xC0});
+            size_t stepped = emit_jump(JUMP_IF_ZERO);
+
+            for (size_t j = i; j < end; ++j) {
+                emit_translated(block.instructions[j]);
+            }
+
+            size_t done = emit_jump(JUMP_ALWAYS);
+            patch_jump(stepped);
+
+            // Taken when an interrupt or event is due inside the run.
+            for (size_t j = i; j < end; ++j) {
+                emit_step(block.instructions[j]);
+            }
+
+            patch_jump(done);
+            i = end;
+        }
+
+        for (size_t jump_end : exit_jumps) {
+            patch_jump(jump_end);
+        }
+
+#ifdef _WIN32
+        // add rsp, 32
+        emit(code, {0x48, 0x83, 0xC4, 0x20});
+#endif
+        // pop rbx; ret
+        emit(code, {0x5B, 0xC3});
+
+        uint8_t *destination = allocate(code.size());
+
+        if (!destination) {
+            return nullptr;
+        }
+
+        set_writable(chunks.back().memory, true);
+        std::memcpy(destination, code.data(), code.size());
+        set_writable(chunks.back().memory, false);
+
+        return reinterpret_cast<NativeBlock>(destination);
+    }
+
+    int32_t JitCompiler::translated_ticks(uint8_t opcode) {
+        uint8_t destination = (opcode >> 3) & 7;
+        uint8_t source = opcode & 7;
+
+        // NOP, CPL, SCF, CCF
+        if (opcode == 0x00 || opcode == 0x2F || opcode == 0x37 || opcode == 0x3F) {
+            return 1;
+        }
+
+        // LD r, r; (HL) operands access memory and 0x76 is HALT.
+        if (opcode >= 0x40 && opcode < 0x80) {
+            return destination == 6 || source == 6 ? 0 : 1;
+        }
+
+        // ALU A, r
+        if (opcode >= 0x80 && opcode < 0xC0) {
+            return source == 6 ? 0 : 1;
+        }
+
+        // ALU A, u8
+        if ((opcode & 0xC7) == 0xC6) {
+            return 2;
+        }
+
+        // INC r, DEC r
+        if ((opcode & 0xC6) == 0x04) {
+            return destination == 6 ? 0 : 1;
+        }
+
+        // LD r, u8
+        if ((opcode & 0xC7) == 0x06) {
+            return destination == 6 ? 0 : 2;
+        }
+
+        return 0;
+    }
+
+    // Same results as the interpreter handlers, see SM83::op_add_a_r and the ops after it.
+    void JitCompiler::emit_translated(const DecodedInstruction &instruction) {
+        uint8_t opcode = instruction.bytes[0];
+        uint8_t destination = (opcode >> 3) & 7;
+        uint8_t source = opcode & 7;
+        int32_t a = layout.registers[7];
+
+        if (opcode >= 0x40 && opcode < 0x80) {
+            load_byte(code, EAX, layout.registers[source]);
+            store_byte(code, EAX, layout.registers[destination]);
+        } else if (opcode >= 0x80 && opcode < 0xC0) {
+            load_byte(code, ECX, layout.registers[source]);
+            emit_alu(destination);
+        } else if ((opcode & 0xC7) == 0xC6) {
+            // mov ecx, <operand>
+            code.push_back(0xB9);
+            emit_uint32(code, instruction.bytes[1]);
+            emit_alu(destination);
+        } else if ((opcode & 0xC6) == 0x04) {
+            bool decrement = opcode & 1;
+
+            load_byte(code, EAX, layout.registers[destination]);
+            // mov edx, eax; xor edx, 1; add/sub eax, 1; xor edx, eax
+            emit(code, {0x89, 0xC2, 0x83, 0xF2, 0x01, 0x83});
+            emit(code, {static_cast<uint8_t>(decrement ? 0xE8 : 0xC0), 0x01, 0x31, 0xC2});
+            store_byte(code, EAX, layout.registers[destination]);
+            store_byte(code, EAX, layout.z_result);
+            store_byte_immediate(code, layout.n_flag, decrement);
+            store_byte(code, EDX, layout.h_bits);
+        } else if ((opcode & 0xC7) == 0x06) {
+            store_byte_immediate(code, layout.registers[destination], instruction.bytes[1]);
+        } else if (opcode == 0x2F) {
+            load_byte(code, EAX, a);
+            // not eax
+            emit(code, {0xF7, 0xD0});
+            store_byte(code, EAX, a);
+            store_byte_immediate(code, layout.n_flag, 1);
+            store_byte_immediate(code, layout.h_bits, 0x10);
+        } else if (opcode == 0x37 || opcode == 0x3F) {
+            store_byte_immediate(code, layout.n_flag, 0);
+            store_byte_immediate(code, layout.h_bits, 0);
+
+            if (opcode == 0x37) {
+                store_word_immediate(code, layout.c_bits, 0x100);
+            } else {
+                load_word(code, EAX, layout.c_bits);
+                // not eax; and eax, 0x100
+                emit(code, {0xF7, 0xD0, 0x25});
+                emit_uint32(code, 0x100);
+                store_word(code, EAX, layout.c_bits);
+            }
+        }
+
+        // add word [pc], <length>
+        emit(code, {0x66, 0x83});
+        emit_cpu_operand(code, 0, layout.pc);
+        code.push_back(instruction_length(opcode));
+    }
+
+    // A <operation> ecx for the ALU operation field of opcodes 0x80-0xBF.
+    void JitCompiler::emit_alu(uint8_t operation) {
+        int32_t a = layout.registers[7];
+
+        if (operation >= 4 && operation < 7) {
+            // and/xor/or eax, ecx
+            static constexpr std::array<uint8_t, 3> LOGIC_OPCODES = {0x21, 0x31, 0x09};
+
+            load_byte(code, EAX, a);
+            emit(code, {LOGIC_OPCODES[operation - 4], 0xC8});
+            store_byte(code, EAX, a);
+            store_byte(code, EAX, layout.z_result);
+            store_byte_immediate(code, layout.n_flag, 0);
+            store_byte_immediate(code, layout.h_bits, operation == 4 ? 0x10 : 0);
+            store_word_immediate(code, layout.c_bits, 0);
+            return;
+        }
+
+        bool subtract = operation >= 2;
+        bool with_carry = operation == 1 || operation == 3;
+
+        if (with_carry) {
+            // eax = carry; shr eax, 8; and eax, 1
+            load_word(code, EAX, layout.c_bits);
+            emit(code, {0xC1, 0xE8, 0x08, 0x83, 0xE0, 0x01});
+
+            if (subtract) {
+                // neg eax
+                emit(code, {0xF7, 0xD8});
+            }
+
+            // edx = A; add eax, edx
+            load_byte(code, EDX, a);
+            emit(code, {0x01, 0xD0});
+        } else {
+            // eax = A; mov edx, eax
+            load_byte(code, EAX, a);
+            emit(code, {0x89, 0xC2});
+        }
+
+        // xor edx, ecx; add/sub eax, ecx; xor edx, eax
+        emit(code, {0x31, 0xCA, static_cast<uint8_t>(subtract ? 0x29 : 0x01), 0xC8, 0x31, 0xC2});
+
+        store_byte(code, EAX, layout.z_result);
+        store_byte_immediate(code, layout.n_flag, subtract);
+        store_byte(code, EDX, layout.h_bits);
+        store_word(code, EAX, layout.c_bits);
+
+        // CP leaves A alone.
+        if (operation != 7) {
+            store_byte(code, EAX, a);
+        }
+    }
+
+    void JitCompiler::emit_step(const DecodedInstruction &instruction) {
+#ifdef _WIN32
+        // mov rcx, rbx; mov rdx, <instruction>
+        emit(code, {0x48, 0x89, 0xD9, 0x48, 0xBA});
+#else
+        // mov rdi, rbx; mov rsi, <instruction>
+        emit(code, {0x48, 0x89, 0xDF, 0x48, 0xBE});
+#endif
+        emit_uint64(code, &instruction);
+        emit_call(reinterpret_cast<const void *>(step));
+
+        // test al, al; jz exit
+        emit(code, {0x84, 0xC0});
+        exit_jumps.push_back(emit_jump(JUMP_IF_ZERO));
+    }
+
+    void JitCompiler::emit_call(const void *function) {
+        // mov rax, <function>; call rax
+        emit(code, {0x48, 0xB8});
+        emit_uint64(code, function);
+        emit(code, {0xFF, 0xD0});
+    }
+
+    // Emits a jump with a 32-bit displacement to be filled in by patch_jump.
+    size_t JitCompiler::emit_jump(uint8_t condition) {
+        if (condition == JUMP_ALWAYS) {
+            code.push_back(0xE9);
+        } else {
+            emit(code, {0x0F, condition});
+        }
+
+        emit_uint32(code, 0);
+        return code.size();
+    }
+
+    // Points the jump ending at jump_end to the current end of the code.
+    void JitCompiler::patch_jump(size_t jump_end) {
+        auto displacement = static_cast<int32_t>(code.size() - jump_end);
+        std::memcpy(&code[jump_end - 4], &displacement, sizeof(displacement));
+    }
+
+    void JitCompiler::clear() {
+        for (auto &chunk : chunks) {
+            unmap_chunk(chunk.memory);
+        }
+
+        chunks.clear();
+    }
+
+    uint8_t *JitCompiler::allocate(size_t size) {
+        if (size > CODE_CHUNK_SIZE) {
+            return nullptr;
+        }
+
+        if (chunks.empty() || (CODE_CHUNK_SIZE - chunks.back().used) < size) {
+            uint8_t *memory = map_chunk();
+
+            if (!memory) {
+                return nullptr;
+            }
+
+            set_writable(memory, false);
+            chunks.push_back({memory, 0});
+        }
+
+        auto &chunk = chunks.back();
+        uint8_t *destination = chunk.memory + chunk.used;
+        // Keep each block 16-byte aligned.
+        chunk.used += (size + 15) & ~size_t{15};
+
+        return destination;
+    }
+}
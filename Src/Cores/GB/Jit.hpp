@@ -0,0 +1,92 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "BlockCache.hpp"
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace GB {
+    class SM83;
+
+    // Times a cached block must run through the interpreter before it is compiled.
+    constexpr uint32_t JIT_HOT_THRESHOLD = 32;
+
+    using NativeBlock = void (*)(SM83 &cpu);
+    // Runs one instruction through its handler, returning false when the block has to be left.
+    using NativeStep = bool (*)(SM83 &cpu, const DecodedInstruction &instruction);
+    // Accounts for a run of translated instructions taking ticks M-cycles, returning false if
+    // it has to be stepped through one instruction at a time instead.
+    using NativeEnter = bool (*)(SM83 &cpu, const DecodedInstruction &first, int32_t count,
+                                 int32_t ticks);
+
+    // Byte offsets into SM83 of the state that translated code accesses directly.
+    struct JitLayout {
+        // Indexed by the 3-bit register field of an opcode; entry 6 ((HL)) is unused.
+        std::array<int32_t, 8> registers{};
+        int32_t pc = 0;
+        int32_t z_result = 0;
+        int32_t n_flag = 0;
+        int32_t h_bits = 0;
+        int32_t c_bits = 0;
+    };
+
+    /*
+        Compiles decoded ROM blocks into x86-64 code. Runs of loads between registers, register
+        and immediate ALU ops and flag-only instructions are translated into host instructions
+        on the SM83 state; as none of them can be observed outside the CPU, a whole run is
+        ticked at once through the enter function. Every other instruction calls the step
+        function, which runs its handler so memory accesses keep ticking the rest of the system.
+    */
+    class JitCompiler {
+    public:
+        JitCompiler(NativeStep step, NativeEnter enter, const JitLayout &layout);
+        JitCompiler(const JitCompiler &) = delete;
+        JitCompiler &operator=(const JitCompiler &) = delete;
+        ~JitCompiler();
+
+        NativeBlock compile(const DecodedBlock &block);
+        void clear();
+
+    private:
+        struct CodeChunk {
+            uint8_t *memory = nullptr;
+            size_t used = 0;
+        };
+
+        // M-cycles taken by an instruction that can be translated, 0 if it has to be stepped.
+        static int32_t translated_ticks(uint8_t opcode);
+
+        void emit_translated(const DecodedInstruction &instruction);
+        void emit_alu(uint8_t operation);
+        void emit_step(const DecodedInstruction &instruction);
+        void emit_call(const void *function);
+        size_t emit_jump(uint8_t condition);
+        void patch_jump(size_t jump_end);
+        uint8_t *allocate(size_t size);
+
+        NativeStep step;
+        NativeEnter enter;
+        JitLayout layout;
+        std::vector<CodeChunk> chunks;
+        std::vector<uint8_t> code;
+        std::vector<size_t> exit_jumps;
+    };
+}
@@ -0,0 +1,296 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "OpcodeProfiler.hpp"
+#include "Bus.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+namespace GB {
+    const std::array<std::string_view, 256> OPCODE_MNEMONICS{
+        "NOP", "LD BC,u16", "LD (BC),A", "INC BC",
+        "INC B", "DEC B", "LD B,u8", "RLCA",
+        "LD (u16),SP", "ADD HL,BC", "LD A,(BC)", "DEC BC",
+        "INC C", "DEC C", "LD C,u8", "RRCA",
+        "STOP", "LD DE,u16", "LD (DE),A", "INC DE",
+        "INC D", "DEC D", "LD D,u8", "RLA",
+        "JR i8", "ADD HL,DE", "LD A,(DE)", "DEC DE",
+        "INC E", "DEC E", "LD E,u8", "RRA",
+        "JR NZ,i8", "LD HL,u16", "LD (HL+),A", "INC HL",
+        "INC H", "DEC H", "LD H,u8", "DAA",
+        "JR Z,i8", "ADD HL,HL", "LD A,(HL+)", "DEC HL",
+        "INC L", "DEC L", "LD L,u8", "CPL",
+        "JR NC,i8", "LD SP,u16", "LD (HL-),A", "INC SP",
+        "INC (HL)", "DEC (HL)", "LD (HL),u8", "SCF",
+        "JR C,i8", "ADD HL,SP", "LD A,(HL-)", "DEC SP",
+        "INC A", "DEC A", "LD A,u8", "CCF",
+        "LD B,B", "LD B,C", "LD B,D", "LD B,E",
+        "LD B,H", "LD B,L", "LD B,(HL)", "LD B,A",
+        "LD C,B", "LD C,C", "LD C,D", "LD C,E",
+        "LD C,H", "LD C,L", "LD C,(HL)", "LD C,A",
+        "LD D,B", "LD D,C", "LD D,D", "LD D,E",
+        "LD D,H", "LD D,L", "LD D,(HL)", "LD D,A",
+        "LD E,B", "LD E,C", "LD E,D", "LD E,E",
+        "LD E,H", "LD E,L", "LD E,(HL)", "LD E,A",
+        "LD H,B", "LD H,C", "LD H,D", "LD H,E",
+        "LD H,H", "LD H,L", "LD H,(HL)", "LD H,A",
+        "LD L,B", "LD L,C", "LD L,D", "LD L,E",
+        "LD L,H", "LD L,L", "LD L,(HL)", "LD L,A",
+        "LD (HL),B", "LD (HL),C", "LD (HL),D", "LD (HL),E",
+        "LD (HL),H", "LD (HL),L", "HALT", "LD (HL),A",
+        "LD A,B", "LD A,C", "LD A,D", "LD A,E",
+        "LD A,H", "LD A,L", "LD A,(HL)", "LD A,A",
+        "ADD A,B", "ADD A,C", "ADD A,D", "ADD A,E",
+        "ADD A,H", "ADD A,L", "ADD A,(HL)", "ADD A,A",
+        "ADC A,B", "ADC A,C", "ADC A,D", "ADC A,E",
+        "ADC A,H", "ADC A,L", "ADC A,(HL)", "ADC A,A",
+        "SUB A,B", "SUB A,C", "SUB A,D", "SUB A,E",
+        "SUB A,H", "SUB A,L", "SUB A,(HL)", "SUB A,A",
+        "SBC A,B", "SBC A,C", "SBC A,D", "SBC A,E",
+        "SBC A,H", "SBC A,L", "SBC A,(HL)", "SBC A,A",
+        "AND A,B", "AND A,C", "AND A,D", "AND A,E",
+        "AND A,H", "AND A,L", "AND A,(HL)", "AND A,A",
+        "XOR A,B", "XOR A,C", "XOR A,D", "XOR A,E",
+        "XOR A,H", "XOR A,L", "XOR A,(HL)", "XOR A,A",
+        "OR A,B", "OR A,C", "OR A,D", "OR A,E",
+        "OR A,H", "OR A,L", "OR A,(HL)", "OR A,A",
+        "CP A,B", "CP A,C", "CP A,D", "CP A,E",
+        "CP A,H", "CP A,L", "CP A,(HL)", "CP A,A",
+        "RET NZ", "POP BC", "JP NZ,u16", "JP u16",
+        "CALL NZ,u16", "PUSH BC", "ADD A,u8", "RST 00h",
+        "RET Z", "RET", "JP Z,u16", "PREFIX CB",
+        "CALL Z,u16", "CALL u16", "ADC A,u8", "RST 08h",
+        "RET NC", "POP DE", "JP NC,u16", "ILLEGAL D3",
+        "CALL NC,u16", "PUSH DE", "SUB A,u8", "RST 10h",
+        "RET C", "RETI", "JP C,u16", "ILLEGAL DB",
+        "CALL C,u16", "ILLEGAL DD", "SBC A,u8", "RST 18h",
+        "LD (FF00+u8),A", "POP HL", "LD (FF00+C),A", "ILLEGAL E3",
+        "ILLEGAL E4", "PUSH HL", "AND A,u8", "RST 20h",
+        "ADD SP,i8", "JP HL", "LD (u16),A", "ILLEGAL EB",
+        "ILLEGAL EC", "ILLEGAL ED", "XOR A,u8", "RST 28h",
+        "LD A,(FF00+u8)", "POP AF", "LD A,(FF00+C)", "DI",
+        "ILLEGAL F4", "PUSH AF", "OR A,u8", "RST 30h",
+        "LD HL,SP+i8", "LD SP,HL", "LD A,(u16)", "EI",
+        "ILLEGAL FC", "ILLEGAL FD", "CP A,u8", "RST 38h",
+    };
+
+    const std::array<std::string_view, 256> CB_OPCODE_MNEMONICS{
+        "RLC B", "RLC C", "RLC D", "RLC E",
+        "RLC H", "RLC L", "RLC (HL)", "RLC A",
+        "RRC B", "RRC C", "RRC D", "RRC E",
+        "RRC H", "RRC L", "RRC (HL)", "RRC A",
+        "RL B", "RL C", "RL D", "RL E",
+        "RL H", "RL L", "RL (HL)", "RL A",
+        "RR B", "RR C", "RR D", "RR E",
+        "RR H", "RR L", "RR (HL)", "RR A",
+        "SLA B", "SLA C", "SLA D", "SLA E",
+        "SLA H", "SLA L", "SLA (HL)", "SLA A",
+        "SRA B", "SRA C", "SRA D", "SRA E",
+        "SRA H", "SRA L", "SRA (HL)", "SRA A",
+        "SWAP B", "SWAP C", "SWAP D", "SWAP E",
+        "SWAP H", "SWAP L", "SWAP (HL)", "SWAP A",
+        "SRL B", "SRL C", "SRL D", "SRL E",
+        "SRL H", "SRL L", "SRL (HL)", "SRL A",
+        "BIT 0,B", "BIT 0,C", "BIT 0,D", "BIT 0,E",
+        "BIT 0,H", "BIT 0,L", "BIT 0,(HL)", "BIT 0,A",
+        "BIT 1,B", "BIT 1,C", "BIT 1,D", "BIT 1,E",
+        "BIT 1,H", "BIT 1,L", "BIT 1,(HL)", "BIT 1,A",
+        "BIT 2,B", "BIT 2,C", "BIT 2,D", "BIT 2,E",
+        "BIT 2,H", "BIT 2,L", "BIT 2,(HL)", "BIT 2,A",
+        "BIT 3,B", "BIT 3,C", "BIT 3,D", "BIT 3,E",
+        "BIT 3,H", "BIT 3,L", "BIT 3,(HL)", "BIT 3,A",
+        "BIT 4,B", "BIT 4,C", "BIT 4,D", "BIT 4,E",
+        "BIT 4,H", "BIT 4,L", "BIT 4,(HL)", "BIT 4,A",
+        "BIT 5,B", "BIT 5,C", "BIT 5,D", "BIT 5,E",
+        "BIT 5,H", "BIT 5,L", "BIT 5,(HL)", "BIT 5,A",
+        "BIT 6,B", "BIT 6,C", "BIT 6,D", "BIT 6,E",
+        "BIT 6,H", "BIT 6,L", "BIT 6,(HL)", "BIT 6,A",
+        "BIT 7,B", "BIT 7,C", "BIT 7,D", "BIT 7,E",
+        "BIT 7,H", "BIT 7,L", "BIT 7,(HL)", "BIT 7,A",
+        "RES 0,B", "RES 0,C", "RES 0,D", "RES 0,E",
+        "RES 0,H", "RES 0,L", "RES 0,(HL)", "RES 0,A",
+        "RES 1,B", "RES 1,C", "RES 1,D", "RES 1,E",
+        "RES 1,H", "RES 1,L", "RES 1,(HL)", "RES 1,A",
+        "RES 2,B", "RES 2,C", "RES 2,D", "RES 2,E",
+        "RES 2,H", "RES 2,L", "RES 2,(HL)", "RES 2,A",
+        "RES 3,B", "RES 3,C", "RES 3,D", "RES 3,E",
+        "RES 3,H", "RES 3,L", "RES 3,(HL)", "RES 3,A",
+        "RES 4,B", "RES 4,C", "RES 4,D", "RES 4,E",
+        "RES 4,H", "RES 4,L", "RES 4,(HL)", "RES 4,A",
+        "RES 5,B", "RES 5,C", "RES 5,D", "RES 5,E",
+        "RES 5,H", "RES 5,L", "RES 5,(HL)", "RES 5,A",
+        "RES 6,B", "RES 6,C", "RES 6,D", "RES 6,E",
+        "RES 6,H", "RES 6,L", "RES 6,(HL)", "RES 6,A",
+        "RES 7,B", "RES 7,C", "RES 7,D", "RES 7,E",
+        "RES 7,H", "RES 7,L", "RES 7,(HL)", "RES 7,A",
+        "SET 0,B", "SET 0,C", "SET 0,D", "SET 0,E",
+        "SET 0,H", "SET 0,L", "SET 0,(HL)", "SET 0,A",
+        "SET 1,B", "SET 1,C", "SET 1,D", "SET 1,E",
+        "SET 1,H", "SET 1,L", "SET 1,(HL)", "SET 1,A",
+        "SET 2,B", "SET 2,C", "SET 2,D", "SET 2,E",
+        "SET 2,H", "SET 2,L", "SET 2,(HL)", "SET 2,A",
+        "SET 3,B", "SET 3,C", "SET 3,D", "SET 3,E",
+        "SET 3,H", "SET 3,L", "SET 3,(HL)", "SET 3,A",
+        "SET 4,B", "SET 4,C", "SET 4,D", "SET 4,E",
+        "SET 4,H", "SET 4,L", "SET 4,(HL)", "SET 4,A",
+        "SET 5,B", "SET 5,C", "SET 5,D", "SET 5,E",
+        "SET 5,H", "SET 5,L", "SET 5,(HL)", "SET 5,A",
+        "SET 6,B", "SET 6,C", "SET 6,D", "SET 6,E",
+        "SET 6,H", "SET 6,L", "SET 6,(HL)", "SET 6,A",
+        "SET 7,B", "SET 7,C", "SET 7,D", "SET 7,E",
+        "SET 7,H", "SET 7,L", "SET 7,(HL)", "SET 7,A",
+    };
+
+    void OpcodeProfiler::reset() {
+        opcodes.fill({});
+        cb_opcodes.fill({});
+        locations.clear();
+        instructions_ = 0;
+        cycles_ = 0;
+        halted_cycles_ = 0;
+    }
+
+    void OpcodeProfiler::record(int32_t bank, uint16_t pc, uint8_t opcode, uint64_t cycles) {
+        auto &op = opcodes[opcode];
+        op.count++;
+        op.cycles += cycles;
+
+        if (opcode == 0xCB) {
+            auto &cb_op = cb_opcodes[last_cb_opcode];
+            cb_op.count++;
+            cb_op.cycles += cycles;
+        }
+
+        auto key = (static_cast<uint64_t>(static_cast<uint32_t>(bank)) << 16) | pc;
+        auto &location = locations[key];
+        location.opcode = opcode;
+        location.stats.count++;
+        location.stats.cycles += cycles;
+
+        instructions_++;
+        cycles_ += cycles;
+    }
+
+    void OpcodeProfiler::record_cb(uint8_t opcode) { last_cb_opcode = opcode; }
+
+    void OpcodeProfiler::record_halted(uint64_t cycles) { halted_cycles_ += cycles; }
+
+    const OpcodeStats &OpcodeProfiler::opcode(uint8_t opcode) const { return opcodes[opcode]; }
+
+    const OpcodeStats &OpcodeProfiler::cb_opcode(uint8_t opcode) const {
+        return cb_opcodes[opcode];
+    }
+
+    uint64_t OpcodeProfiler::instructions() const { return instructions_; }
+
+    uint64_t OpcodeProfiler::cycles() const { return cycles_; }
+
+    uint64_t OpcodeProfiler::halted_cycles() const { return halted_cycles_; }
+
+    static double percent(uint64_t value, uint64_t total) {
+        return total ? (100.0 * static_cast<double>(value) / static_cast<double>(total)) : 0.0;
+    }
+
+    static void write_opcode_table(std::ostream &out, std::string_view title,
+                                   const std::array<OpcodeStats, 256> &table,
+                                   const std::array<std::string_view, 256> &mnemonics,
+                                   uint64_t total_cycles) {
+        std::vector<uint8_t> order;
+
+        for (size_t i = 0; i < table.size(); ++i) {
+            if (table[i].count) {
+                order.push_back(static_cast<uint8_t>(i));
+            }
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&table](uint8_t a, uint8_t b) {
+            return table[a].cycles > table[b].cycles;
+        });
+
+        out << "\n" << title << "\n";
+        out << "  op  mnemonic            count          cycles   cycles%  cyc/op\n";
+
+        for (auto op : order) {
+            const auto &stats = table[op];
+
+            out << "  " << std::hex << std::uppercase << std::setfill('0') << std::setw(2)
+                << static_cast<int32_t>(op) << std::dec << std::setfill(' ') << "  "
+                << std::left << std::setw(16) << mnemonics[op] << std::right << std::setw(9)
+                << stats.count << std::setw(16) << stats.cycles << std::setw(9)
+                << percent(stats.cycles, total_cycles) << std::setw(8)
+                << static_cast<double>(stats.cycles) / static_cast<double>(stats.count) << "\n";
+        }
+    }
+
+    void OpcodeProfiler::write_report(std::ostream &out, size_t max_locations) const {
+        auto flags = out.flags();
+        auto precision = out.precision();
+        out << std::fixed << std::setprecision(2);
+
+        out << "instructions: " << instructions_ << "\n";
+        out << "cycles: " << cycles_ << "\n";
+        out << "halted cycles: " << halted_cycles_ << "\n";
+
+        write_opcode_table(out, "opcodes", opcodes, OPCODE_MNEMONICS, cycles_);
+        write_opcode_table(out, "cb opcodes", cb_opcodes, CB_OPCODE_MNEMONICS, cycles_);
+
+        std::vector<std::pair<uint64_t, const LocationStats *>> hot;
+        hot.reserve(locations.size());
+
+        for (const auto &[key, location] : locations) {
+            hot.emplace_back(key, &location);
+        }
+
+        auto count = std::min(max_locations, hot.size());
+        std::partial_sort(hot.begin(), hot.begin() + count, hot.end(),
+                          [](const auto &a, const auto &b) {
+                              if (a.second->stats.cycles != b.second->stats.cycles) {
+                                  return a.second->stats.cycles > b.second->stats.cycles;
+                              }
+                              return a.first < b.first;
+                          });
+
+        out << "\nhot locations (" << count << " of " << hot.size() << ")\n";
+        out << "  bank:pc     op  mnemonic            count          cycles   cycles%\n";
+
+        for (size_t i = 0; i < count; ++i) {
+            auto [key, location] = hot[i];
+            auto bank = static_cast<int32_t>(static_cast<uint32_t>(key >> 16));
+            auto pc = static_cast<uint16_t>(key & 0xFFFF);
+
+            out << "  " << std::hex << std::uppercase << std::setfill('0');
+
+            if (bank == BOOTSTRAP_ROM_BANK) {
+                out << "boot";
+            } else {
+                out << std::setw(4) << bank;
+            }
+
+            out << ":" << std::setw(4) << pc << "  " << std::setw(2)
+                << static_cast<int32_t>(location->opcode) << std::dec << std::setfill(' ')
+                << "  " << std::left << std::setw(16) << OPCODE_MNEMONICS[location->opcode]
+                << std::right << std::setw(9) << location->stats.count << std::setw(16)
+                << location->stats.cycles << std::setw(9)
+                << percent(location->stats.cycles, cycles_) << "\n";
+        }
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+}
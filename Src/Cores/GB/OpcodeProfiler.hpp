@@ -0,0 +1,69 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <array>
+#include <cinttypes>
+#include <iosfwd>
+#include <string_view>
+#include <unordered_map>
+
+namespace GB {
+    struct OpcodeStats {
+        uint64_t count = 0;
+        uint64_t cycles = 0;
+    };
+
+    extern const std::array<std::string_view, 256> OPCODE_MNEMONICS;
+    extern const std::array<std::string_view, 256> CB_OPCODE_MNEMONICS;
+
+    /*
+        Records how often each instruction executes and how many cycles it was charged, both per
+        opcode and per (ROM bank, PC). Attach one with SM83::set_opcode_profiler; while none is
+        attached the CPU only pays a null check per instruction.
+    */
+    class OpcodeProfiler {
+    public:
+        void reset();
+
+        void record(int32_t bank, uint16_t pc, uint8_t opcode, uint64_t cycles);
+        void record_cb(uint8_t opcode);
+        void record_halted(uint64_t cycles);
+
+        const OpcodeStats &opcode(uint8_t opcode) const;
+        const OpcodeStats &cb_opcode(uint8_t opcode) const;
+        uint64_t instructions() const;
+        uint64_t cycles() const;
+        uint64_t halted_cycles() const;
+
+        void write_report(std::ostream &out, size_t max_locations = 64) const;
+
+    private:
+        struct LocationStats {
+            uint8_t opcode = 0;
+            OpcodeStats stats{};
+        };
+
+        std::array<OpcodeStats, 256> opcodes{};
+        std::array<OpcodeStats, 256> cb_opcodes{};
+        std::unordered_map<uint64_t, LocationStats> locations{};
+        uint64_t instructions_ = 0;
+        uint64_t cycles_ = 0;
+        uint64_t halted_cycles_ = 0;
+        uint8_t last_cb_opcode = 0;
+    };
+}
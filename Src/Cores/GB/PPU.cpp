@@ -19,58 +19,103 @@
 #include "PPU.hpp"
 #include "Constants.hpp"
 #include "Core.hpp"
+#include "PixelKernels.hpp"
 #include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <span>
 #include <stdexcept>
 
 namespace GB {
+    namespace {
+        using ColorTable = std::array<uint32_t, 32768>;
+
+        uint32_t pack_rgba(uint8_t r, uint8_t g, uint8_t b) {
+            std::array<uint8_t, 4> rgba{r, g, b, 255};
+            uint32_t value = 0;
+
+            std::memcpy(&value, rgba.data(), rgba.size());
+            return value;
+        }
+
+        // Maps every RGB555 color to RGBA8888 in framebuffer byte order.
+        ColorTable build_color_table(ColorCorrection mode) {
+            ColorTable table{};
+            std::array<uint8_t, 32> gamma{};
+
+            // The CGB LCD has a much steeper response than a PC monitor, so dark colors
+            // look washed out when scaled linearly.
+            for (size_t i = 0; i < gamma.size(); ++i) {
+                gamma[i] = static_cast<uint8_t>(std::lround(std::pow(i / 31.0, 4.0 / 2.2) * 255));
+            }
+
+            for (uint32_t color = 0; color < table.size(); ++color) {
+                uint32_t r = color & 0x1F;
+                uint32_t g = (color >> 5) & 0x1F;
+                uint32_t b = (color >> 10) & 0x1F;
+
+                switch (mode) {
+                case ColorCorrection::Raw: {
+                    table[color] = pack_rgba((r * 255) / 31, (g * 255) / 31, (b * 255) / 31);
+                    break;
+                }
+                case ColorCorrection::GBCLCD: {
+                    // Approximates the channel bleed and reduced brightness of the CGB screen.
+                    uint32_t out_r = std::min<uint32_t>((r * 26) + (g * 4) + (b * 2), 960);
+                    uint32_t out_g = std::min<uint32_t>((g * 24) + (b * 8), 960);
+                    uint32_t out_b = std::min<uint32_t>((r * 6) + (g * 4) + (b * 22), 960);
+
+                    table[color] = pack_rgba(out_r >> 2, out_g >> 2, out_b >> 2);
+                    break;
+                }
+                case ColorCorrection::Gamma: {
+                    table[color] = pack_rgba(gamma[r], gamma[g], gamma[b]);
+                    break;
+                }
+                }
+            }
+
+            return table;
+        }
+
+        const ColorTable &color_table(ColorCorrection mode) {
+            static const std::array<ColorTable, 3> tables{
+                build_color_table(ColorCorrection::Raw),
+                build_color_table(ColorCorrection::GBCLCD),
+                build_color_table(ColorCorrection::Gamma),
+            };
+
+            return tables[static_cast<size_t>(mode)];
+        }
+
+        size_t frame_size(PixelFormat format) {
+            size_t pixels = LCD_WIDTH * LCD_HEIGHT;
+            return pixels * ((format == PixelFormat::RGB565) ? 2 : FRAMEBUFFER_COLOR_CHANNELS);
+        }
+    }
+
     uint8_t BackgroundFIFO::pixel_attribute() const { return attribute; }
 
     uint8_t BackgroundFIFO::pixels_left() const { return shift_count; }
 
     void BackgroundFIFO::clear() {
         shift_count = 0;
-        pixels_low = 0;
-        pixels_high = 0;
         attribute = 0;
+        pixels.fill(0);
     }
 
-    void BackgroundFIFO::load(uint8_t low, uint8_t high, uint8_t attribute) {
-        pixels_low = low;
-        pixels_high = high;
+    // Rows come from the tile cache already flipped according to the attribute.
+    void BackgroundFIFO::load(const TileCache::Row &row, uint8_t attribute) {
+        pixels = row;
         shift_count = 8;
         this->attribute = attribute;
-
-        if (attribute & TILE_FLIP_X_BIT) {
-            auto byte_reverse = [](uint8_t input) -> uint8_t {
-                input = ((input & 0b11110000) >> 4) | ((input & 0b00001111) << 4);
-                input = ((input & 0b11001100) >> 2) | ((input & 0b00110011) << 2);
-                input = ((input & 0b10101010) >> 1) | ((input & 0b01010101) << 1);
-                return input;
-            };
-
-            pixels_low = byte_reverse(pixels_low);
-            pixels_high = byte_reverse(pixels_high);
-        }
     }
 
-    void BackgroundFIFO::force_shift(uint8_t amount) {
-        pixels_low <<= amount;
-        pixels_high <<= amount;
-        shift_count -= amount;
-    }
-
-    uint8_t BackgroundFIFO::clock() {
-        uint8_t low_bit = (pixels_low >> 7) & 0x1;
-        uint8_t high_bit = (pixels_high >> 7) & 0x1;
-        uint8_t pixel = (high_bit << 1) | (low_bit);
-
-        pixels_low <<= 1;
-        pixels_high <<= 1;
+    void BackgroundFIFO::force_shift(uint8_t amount) { shift_count -= amount; }
 
-        shift_count--;
-        return pixel;
-    }
+    uint8_t BackgroundFIFO::clock() { return pixels[8 - shift_count--]; }
 
     FetchState BackgroundFetcher::get_state() const { return state; }
 
@@ -87,16 +132,17 @@ namespace GB {
         attribute_id = 0;
         queued_pixels_low = 0;
         queued_pixels_high = 0;
+        queued_row.fill(0);
         x_pos = 0;
         address = 0;
         state = FetchState::GetTileID;
         mode = new_mode;
     }
 
-    void BackgroundFetcher::clock(PPU &ppu) {
+    template <bool compat_mode> void BackgroundFetcher::clock(PPU &ppu) {
         switch (state) {
         case FetchState::GetTileID: {
-            get_tile_id(ppu);
+            get_tile_id<compat_mode>(ppu);
             break;
         }
         case FetchState::TileLow: {
@@ -114,7 +160,7 @@ namespace GB {
         }
     }
 
-    void BackgroundFetcher::get_tile_id(PPU &ppu) {
+    template <bool compat_mode> void BackgroundFetcher::get_tile_id(PPU &ppu) {
         switch (substep) {
         case 0: {
             uint16_t computed_address = 0b10011 << 11;
@@ -155,7 +201,8 @@ namespace GB {
 
         case 1: {
             tile_id = ppu.vram[address];
-            attribute_id = ppu.vram[0x2000 + address];
+            // DMG games have no attribute map, so tiles always come unflipped from bank 0.
+            attribute_id = compat_mode ? 0 : ppu.vram[0x2000 + address];
             state = FetchState::TileLow;
 
             substep = 0;
@@ -213,8 +260,17 @@ namespace GB {
                 state = FetchState::Push;
 
                 auto bank = (attribute_id & 0x8) >> 3;
+                uint16_t row_address = (0x2000 * bank) + (address & ~0x1);
+                bool flip_x = attribute_id & TILE_FLIP_X_BIT;
                 queued_pixels_high = ppu.vram[(0x2000 * bank) + address];
 
+                // A write between the two plane reads gives a row that was never in VRAM.
+                if (ppu.vram[row_address] == queued_pixels_low) {
+                    queued_row = ppu.tile_cache.row(ppu.vram, row_address, flip_x);
+                } else {
+                    TileCache::decode(queued_pixels_low, queued_pixels_high, flip_x, queued_row);
+                }
+
                 if (first_fetch) {
                     state = FetchState::GetTileID;
                     first_fetch = false;
@@ -235,7 +291,7 @@ namespace GB {
             return;
 
         x_pos += 8;
-        ppu.bg_fifo.load(queued_pixels_low, queued_pixels_high, attribute_id);
+        ppu.bg_fifo.load(queued_row, attribute_id);
 
         if (mode == FetchMode::Background) {
             if (ppu.line_x == 0) {
@@ -250,22 +306,26 @@ namespace GB {
         state = FetchState::GetTileID;
     }
 
-    PPU::PPU(Core *core) : core(core) {
+    PPU::PPU(Core *core) : color_lut(&color_table(ColorCorrection::Raw)), core(core) {
         if (!core) {
             throw std::invalid_argument("Core cannot be null.");
         }
     }
 
-    std::span<uint8_t, LCD_WIDTH * LCD_HEIGHT * 4> PPU::framebuffer() {
-        return framebuffer_complete;
+    std::span<uint8_t> PPU::framebuffer() {
+        return frames.front();
     }
 
+    PixelFormat PPU::get_pixel_format() const { return pixel_format; }
+
     void PPU::reset() {
+        synced_cycles = core->elapsed_cycles();
         fetcher.reset();
         bg_fifo.clear();
 
         window_draw_flag = false;
         previously_disabled = false;
+        line_rendered = false;
         num_obj_on_scanline = 0;
         line_x = 0;
         cycles = 0;
@@ -293,15 +353,27 @@ namespace GB {
 
         obj_cram.fill(0);
         bg_cram.fill(0);
+        palette_written = false;
+
+        for (uint8_t color = 0; color < 32; ++color) {
+            update_palette_rgba(false, color);
+            update_palette_rgba(true, color);
+        }
 
         vram.fill(0);
+        tile_cache.reset();
 
         oam.fill(0);
         objects_on_scanline.fill(Object{});
+        line_objects[0].fill(0);
+        line_objects[1].fill(0);
 
         bg_color_table.fill(0);
-        internal_framebuffer.fill(0);
-        framebuffer_complete.fill(0);
+        // The first frame after a reset can be published without drawing a line, so the
+        // image after this one is cleared as well.
+        frames.back().fill(0);
+        frames.publish(frame_size(pixel_format));
+        frames.back().fill(0);
     }
 
     void PPU::set_post_boot_state() {
@@ -312,6 +384,7 @@ namespace GB {
         screen_scroll_y = 0;
         line_y = 0;
         background_palette = 0xFC;
+        schedule_next_event();
     }
 
     void PPU::set_compatibility_palette(PaletteID palette_type,
@@ -334,12 +407,43 @@ namespace GB {
             break;
         }
         }
+
+        for (uint8_t color = 0; color < 32; ++color) {
+            update_palette_rgba(false, color);
+            update_palette_rgba(true, color);
+        }
+        palette_written = true;
     }
 
-    void PPU::step(int32_t accumulated_cycles) {
+    void PPU::set_color_correction(ColorCorrection mode) {
+        if (mode == color_correction) {
+            return;
+        }
+
+        color_correction = mode;
+        color_lut = &color_table(mode);
+
+        for (uint8_t color = 0; color < 32; ++color) {
+            update_palette_rgba(false, color);
+            update_palette_rgba(true, color);
+        }
+        palette_written = true;
+    }
+
+    void PPU::set_pixel_format(PixelFormat format) { pixel_format = format; }
+
+    void PPU::set_compatibility_mode(bool compat) {
+        step_function = compat ? &PPU::step_pipeline<true> : &PPU::step_pipeline<false>;
+        resume_function = compat ? &PPU::resume_pixel_fifo<true> : &PPU::resume_pixel_fifo<false>;
+    }
+
+    void PPU::step(int32_t accumulated_cycles) { (this->*step_function)(accumulated_cycles); }
+
+    template <bool compat_mode> void PPU::step_pipeline(int32_t accumulated_cycles) {
         if (!(lcd_control & LCD_ENABLED_BIT)) {
             set_mode(HBLANK);
             previously_disabled = true;
+            line_rendered = false;
             return;
         }
 
@@ -401,7 +505,7 @@ namespace GB {
                     cycles = 0;
 
                     if (line_y > 153) {
-                        framebuffer_complete = internal_framebuffer;
+                        frames.publish(frame_size(pixel_format));
                         set_mode(OAM_SEARCH);
 
                         if ((status & OAM_STAT_INT_BIT) && allow_interrupt) {
@@ -427,6 +531,11 @@ namespace GB {
                     set_mode(PIXEL_TRANSFER);
                     fetcher.reset();
                     bg_fifo.clear();
+
+                    // Drawn up front, a write before the line ends falls back to the FIFO.
+                    palette_written = false;
+                    render_line<compat_mode>();
+                    line_rendered = true;
                     continue;
                 }
 
@@ -435,7 +544,8 @@ namespace GB {
 
             case PIXEL_TRANSFER: {
                 if (cycles == 172 + extra_cycles) {
-                    render_objects();
+                    render_objects<compat_mode>();
+                    line_rendered = false;
                     cycles = 0;
 
                     set_mode(HBLANK);
@@ -448,8 +558,14 @@ namespace GB {
                     }
 
                     continue;
+                } else if (line_rendered) {
+                    // Nothing changes until the end of pixel transfer, skip to its last dot.
+                    int32_t skip =
+                        std::min(accumulated_cycles, (172 + extra_cycles) - cycles) - 1;
+                    accumulated_cycles -= skip;
+                    cycles += skip;
                 } else {
-                    render_scanline();
+                    render_scanline<compat_mode>();
                 }
                 break;
             }
@@ -462,15 +578,113 @@ namespace GB {
         }
     }
 
+    /*
+        Runs the PPU up to the master clock. The PPU only catches up when the CPU touches VRAM,
+        OAM or one of its registers, when its scheduled event is due and at the end of a frame,
+        so pixel transfer runs in long bursts instead of a few dots per M-cycle.
+    */
+    void PPU::sync() {
+        uint64_t now = core->elapsed_cycles();
+
+        while (synced_cycles != now) {
+            auto dots = static_cast<int32_t>(
+                std::min<uint64_t>(now - synced_cycles, std::numeric_limits<int32_t>::max()));
+
+            step(dots);
+            synced_cycles += dots;
+        }
+    }
+
+    /*
+        Every interrupt the PPU raises happens at a mode or line change. Those are only worth
+        waking up for when a STAT source is enabled, otherwise the next one is VBlank.
+    */
+    void PPU::schedule_next_event() {
+        constexpr uint8_t STAT_SOURCES = LYC_LY_STAT_INT_BIT | OAM_STAT_INT_BIT |
+                                         VBLANK_STAT_INT_BIT | HBLANK_STAT_INT_BIT;
+
+        if (!(lcd_control & LCD_ENABLED_BIT)) {
+            core->scheduler.cancel(EventType::PPU);
+            return;
+        }
+
+        int32_t dots = (status & STAT_SOURCES) ? cycles_until_event() : cycles_until_vblank();
+        core->scheduler.schedule(EventType::PPU, synced_cycles + std::max(dots, 1));
+    }
+
+    // Dots until the next mode or line change, the only points where the PPU raises interrupts.
+    int32_t PPU::cycles_until_event() const {
+        if (!(lcd_control & LCD_ENABLED_BIT)) {
+            return std::numeric_limits<int32_t>::max();
+        }
+
+        if (previously_disabled) {
+            return 0;
+        }
+
+        switch (status & 0x3) {
+        case HBLANK: {
+            return (204 - extra_cycles) - cycles + 1;
+        }
+        case VBLANK: {
+            return 456 - cycles + 1;
+        }
+        case OAM_SEARCH: {
+            return 80 - cycles + 1;
+        }
+        default: {
+            // Sprites and SCX can only push the end of pixel transfer further out.
+            return (172 + extra_cycles) - cycles + 1;
+        }
+        }
+    }
+
+    // Line length is fixed, sprites and SCX only move dots from HBlank into pixel transfer.
+    int32_t PPU::cycles_until_vblank() const {
+        constexpr int32_t VBLANK_START = 144 * DOTS_PER_LINE;
+
+        if (previously_disabled) {
+            return 0;
+        }
+
+        int32_t frame_dot = (line_y * DOTS_PER_LINE) + cycles;
+
+        switch (status & 0x3) {
+        case PIXEL_TRANSFER: {
+            frame_dot += 80;
+            break;
+        }
+        case HBLANK: {
+            frame_dot += 80 + 172 + extra_cycles;
+            break;
+        }
+        }
+
+        if (frame_dot < VBLANK_START) {
+            return VBLANK_START - frame_dot + 1;
+        }
+
+        return CYCLES_PER_FRAME - frame_dot + VBLANK_START + 1;
+    }
+
     void PPU::write_register(uint8_t reg, uint8_t value) {
+        sync();
+
+        if (line_rendered) {
+            (this->*resume_function)();
+        }
+
         switch (reg) {
+        // LCD enable, STAT sources and LYC can raise an interrupt on the very next dot.
         case 0x40: {
             lcd_control = value;
+            core->scheduler.schedule(EventType::PPU, synced_cycles + 1);
             return;
         }
         case 0x41: {
             status &= 0x3;
             status |= value & 0xF8;
+            core->scheduler.schedule(EventType::PPU, synced_cycles + 1);
             return;
         }
         case 0x42: {
@@ -483,6 +697,7 @@ namespace GB {
         }
         case 0x45: {
             line_y_compare = value;
+            core->scheduler.schedule(EventType::PPU, synced_cycles + 1);
             return;
         }
         case 0x46: {
@@ -539,7 +754,9 @@ namespace GB {
         }
     }
 
-    uint8_t PPU::read_register(uint8_t reg) const {
+    uint8_t PPU::read_register(uint8_t reg) {
+        sync();
+
         switch (reg) {
         case 0x40: {
             return lcd_control;
@@ -600,19 +817,42 @@ namespace GB {
     }
 
     void PPU::write_vram(uint16_t address, uint8_t value) {
+        sync();
+
+        if (line_rendered) {
+            (this->*resume_function)();
+        }
         vram[(vram_bank_select * 0x2000) + address] = value;
+        tile_cache.invalidate((vram_bank_select * 0x2000) + address);
     }
 
-    uint8_t PPU::read_vram(uint16_t address) const {
+    uint8_t PPU::read_vram(uint16_t address) {
+        sync();
         return vram[(vram_bank_select * 0x2000) + address];
     }
 
-    void PPU::write_oam(uint16_t address, uint8_t value) { oam[address] = value; }
+    void PPU::write_oam(uint16_t address, uint8_t value) {
+        sync();
+
+        if (line_rendered) {
+            (this->*resume_function)();
+        }
+
+        if ((address < 160) && !(address & 0x3)) {
+            index_object(address >> 2, value);
+        }
+        oam[address] = value;
+    }
 
-    uint8_t PPU::read_oam(uint16_t address) const { return oam[address]; }
+    uint8_t PPU::read_oam(uint16_t address) {
+        sync();
+        return oam[address];
+    }
 
     void PPU::write_bg_palette(uint8_t value) {
         bg_cram[bg_palette_select & 0x3F] = value;
+        update_palette_rgba(false, (bg_palette_select & 0x3F) >> 1);
+        palette_written = true;
 
         if (bg_palette_select & 0x80) {
             bg_palette_select = ((bg_palette_select + 1) & 0x3F) | 0x80;
@@ -623,6 +863,8 @@ namespace GB {
 
     void PPU::write_obj_palette(uint8_t value) {
         obj_cram[obj_palette_select & 0x3F] = value;
+        update_palette_rgba(true, (obj_palette_select & 0x3F) >> 1);
+        palette_written = true;
 
         if (obj_palette_select & 0x80) {
             obj_palette_select = ((obj_palette_select + 1) & 0x3F) | 0x80;
@@ -634,7 +876,12 @@ namespace GB {
     void PPU::instant_dma(uint8_t address) {
         uint16_t addr = address << 8;
         for (int i = 0; i < 160; ++i) {
-            oam[i] = core->bus.read(addr + i);
+            uint8_t value = core->bus.read(addr + i);
+
+            if (!(i & 0x3)) {
+                index_object(i >> 2, value);
+            }
+            oam[i] = value;
         }
     }
 
@@ -676,36 +923,14 @@ namespace GB {
         return false;
     }
 
-    void PPU::render_scanline() {
-        fetcher.clock(*this);
+    template <bool compat_mode> void PPU::render_scanline() {
+        fetcher.clock<compat_mode>(*this);
 
         if ((line_x < 160) && bg_fifo.pixels_left()) {
-            uint8_t final_pixel = 0, final_palette = bg_fifo.pixel_attribute() & 0x7;
-            uint8_t final_dmg_palette = background_palette;
-            uint8_t bg_pixel = bg_fifo.clock();
-
-            bool bg_enabled =
-                core->bus.is_compatibility_mode() ? (lcd_control & BG_ENABLED_BIT) : true;
-
-            if (!bg_enabled) {
-                final_pixel = 0;
-                final_palette = 0;
-                final_dmg_palette = 0;
-            } else {
-                final_pixel = bg_pixel;
-            }
-
-            bg_color_table[(line_y * LCD_WIDTH) + line_x] =
-                final_pixel | (static_cast<uint16_t>(bg_fifo.pixel_attribute()) << 8);
-
-            if (core->bus.is_compatibility_mode()) {
-                uint8_t cgb_pixel = (final_dmg_palette >> (int)(2 * final_pixel)) & 3;
-
-                plot_cgb_pixel(line_x, cgb_pixel, 0, false);
-            } else {
-                plot_cgb_pixel(line_x, final_pixel, final_palette, false);
-            }
+            uint8_t attribute = bg_fifo.pixel_attribute();
 
+            plot_background_pixel<compat_mode>(line_x, bg_fifo.clock(), attribute);
+            expand_pixels(line_x, 1);
             line_x++;
         }
 
@@ -718,12 +943,81 @@ namespace GB {
         }
     }
 
-    void PPU::render_objects() {
-        if (!(lcd_control & OBJECTS_ENABLED_BIT)) {
+    /*
+        Draws the background and window of the current line in one pass, with the same pixels and
+        pixel transfer length the fetcher and FIFO produce when clocked dot by dot. Only valid
+        while nothing the PPU reads changes until the end of the line, see resume_pixel_fifo().
+    */
+    template <bool compat_mode> void PPU::render_line() {
+        bool window = (lcd_control & WND_ENABLED_BIT) && window_draw_flag && (window_x <= 167);
+        int32_t window_start = window ? std::max(0, window_x - 7) : LCD_WIDTH;
+
+        // SCX is only discarded from the first push, which never happens if the window starts
+        // at pixel 0.
+        extra_cycles = (window_start == 0) ? 0 : (screen_scroll_x & 7);
+
+        if (window) {
+            extra_cycles += 6;
+            fetcher.clear_with_mode(FetchMode::Window);
+        }
+
+        for (int32_t x = 0; x < LCD_WIDTH;) {
+            bool in_window = x >= window_start;
+            uint8_t map_x = in_window ? (x - window_start) : (x + screen_scroll_x);
+            uint8_t map_y = in_window ? window_line_y : (line_y + screen_scroll_y);
+            uint8_t map_bit = in_window ? WND_TILE_MAP_BIT : BG_TILE_MAP_BIT;
+
+            uint16_t map_address = 0x1800 | ((lcd_control & map_bit) ? 0x400 : 0) |
+                                   ((map_y / 8) << 5) | (map_x / 8);
+            uint8_t tile_id = vram[map_address];
+            uint8_t attribute = compat_mode ? 0 : vram[0x2000 + map_address];
+
+            uint8_t row = (attribute & TILE_FLIP_Y_BIT) ? (7 - (map_y & 7)) : (map_y & 7);
+            bool bit12 = !((lcd_control & TILE_DATA_LOC_BIT) || (tile_id & 0x80));
+            uint16_t data_address = (0x2000 * ((attribute & 0x8) >> 3)) + (bit12 ? 0x1000 : 0) +
+                                    (tile_id * 16) + (row * 2);
+
+            const TileCache::Row &pixels =
+                tile_cache.row(vram, data_address, attribute & TILE_FLIP_X_BIT);
+
+            int32_t end = std::min(x + 8 - (map_x & 7), in_window ? LCD_WIDTH : window_start);
+
+            for (uint8_t column = map_x & 7; x < end; ++x, ++column) {
+                plot_background_pixel<compat_mode>(x, pixels[column], attribute);
+            }
+        }
+
+        expand_pixels(0, LCD_WIDTH);
+        line_x = LCD_WIDTH;
+    }
+
+    /*
+        Called before a write lands in the middle of a line drawn by render_line(). Replays the
+        dots of pixel transfer seen so far through the fetcher and FIFO, which redraws the same
+        pixels and leaves them in the state the rest of the line continues from.
+    */
+    template <bool compat_mode> void PPU::resume_pixel_fifo() {
+        int32_t elapsed = cycles;
+
+        line_rendered = false;
+        line_x = 0;
+        cycles = 0;
+        extra_cycles = 0;
+        fetcher.reset();
+        bg_fifo.clear();
+
+        for (; cycles < elapsed; ++cycles) {
+            render_scanline<compat_mode>();
+        }
+    }
+
+    template <bool compat_mode> void PPU::render_objects() {
+        if (!(lcd_control & OBJECTS_ENABLED_BIT) || (num_obj_on_scanline == 0)) {
             return;
         }
 
         uint8_t height = (lcd_control & OBJECT_SIZE_BIT) ? 16 : 8;
+        int32_t first_x = LCD_WIDTH, last_x = -1;
 
         for (int i = 0; i < num_obj_on_scanline; ++i) {
             auto &object = objects_on_scanline[(num_obj_on_scanline - 1) - i];
@@ -737,7 +1031,8 @@ namespace GB {
             }
 
             uint8_t cgb_palette = (object.attributes & CGB_PALETTE_NUM_MASK);
-            uint16_t bank = 0x2000 * ((object.attributes & VRAM_BANK_SELECT_BIT) >> 3);
+            uint16_t bank =
+                compat_mode ? 0 : 0x2000 * ((object.attributes & VRAM_BANK_SELECT_BIT) >> 3);
 
             uint16_t tile_index = 0;
 
@@ -755,6 +1050,11 @@ namespace GB {
                     (0x8000 & 0x1FFF) + (object.tile * 16) + ((line_y - obj_y) % height * 2);
             }
 
+            // Switching to 8x8 objects after the OAM scan can put the row outside the tile, keep
+            // it inside the object tile area.
+            const TileCache::Row &pixels = tile_cache.row(vram, bank + (tile_index & 0x0FFF),
+                                                          object.attributes & TILE_FLIP_X_BIT);
+
             int32_t adjusted_x = static_cast<int32_t>(object.x) - 8;
             size_t framebuffer_line_y = line_y * LCD_WIDTH;
 
@@ -762,17 +1062,7 @@ namespace GB {
                 size_t framebuffer_line_x = adjusted_x + x;
 
                 if (framebuffer_line_x >= 0 && framebuffer_line_x < 160) {
-                    uint8_t low_byte = vram[bank + tile_index];
-                    uint8_t high_byte = vram[bank + (tile_index + 1)];
-                    uint8_t bit = 7 - (x & 7);
-
-                    if (object.attributes & TILE_FLIP_X_BIT) {
-                        bit = x & 7;
-                    }
-
-                    uint8_t low_bit = (low_byte >> bit) & 0x01;
-                    uint8_t high_bit = (high_byte >> bit) & 0x01;
-                    uint8_t pixel = (high_bit << 1) | low_bit;
+                    uint8_t pixel = pixels[x];
 
                     if (pixel == 0) {
                         continue;
@@ -789,7 +1079,7 @@ namespace GB {
 
                     bool bg_has_priority = false;
 
-                    if (core->bus.is_compatibility_mode()) {
+                    if constexpr (compat_mode) {
                         bg_has_priority = bg_pixel && (object.attributes & PRIORITY_BIT);
 
                         if (!bg_has_priority) {
@@ -805,56 +1095,96 @@ namespace GB {
                             plot_cgb_pixel(framebuffer_line_x, pixel, cgb_palette, true);
                         }
                     }
+
+                    if (bg_has_priority) {
+                        continue;
+                    }
+
+                    // Background pixels already on screen used the palette from before the
+                    // write, so only the object pixels can be converted now.
+                    if (palette_written) {
+                        expand_pixels(framebuffer_line_x, 1);
+                    }
+
+                    first_x = std::min<int32_t>(first_x, framebuffer_line_x);
+                    last_x = std::max<int32_t>(last_x, framebuffer_line_x);
                 }
             }
         }
+
+        if (!palette_written && (last_x >= first_x)) {
+            expand_pixels(first_x, (last_x - first_x) + 1);
+        }
     }
 
-    void PPU::plot_cgb_pixel(uint8_t x_pos, uint8_t final_pixel, uint8_t palette, bool is_obj) {
-        size_t framebuffer_line_y = line_y * LCD_WIDTH;
-        size_t select_color = (palette * 8) + (final_pixel * 2);
+    template <bool compat_mode>
+    void PPU::plot_background_pixel(uint8_t x_pos, uint8_t pixel, uint8_t attribute) {
+        uint8_t final_pixel = pixel, final_palette = attribute & 0x7;
+        uint8_t final_dmg_palette = background_palette;
+
+        bool bg_enabled = compat_mode ? (lcd_control & BG_ENABLED_BIT) : true;
+
+        if (!bg_enabled) {
+            final_pixel = 0;
+            final_palette = 0;
+            final_dmg_palette = 0;
+        }
+
+        bg_color_table[(line_y * LCD_WIDTH) + x_pos] =
+            final_pixel | (static_cast<uint16_t>(attribute) << 8);
 
-        uint16_t color = 0;
+        if constexpr (compat_mode) {
+            uint8_t cgb_pixel = (final_dmg_palette >> (int)(2 * final_pixel)) & 3;
 
-        if (is_obj) {
-            color = obj_cram[select_color];
-            color |= obj_cram[select_color + 1] << 8;
+            plot_cgb_pixel(x_pos, cgb_pixel, 0, false);
         } else {
-            color = bg_cram[select_color];
-            color |= bg_cram[select_color + 1] << 8;
+            plot_cgb_pixel(x_pos, final_pixel, final_palette, false);
+        }
+    }
+
+    void PPU::plot_cgb_pixel(uint8_t x_pos, uint8_t final_pixel, uint8_t palette, bool is_obj) {
+        line_colors[x_pos] = (is_obj ? 32 : 0) + (palette * 4) + final_pixel;
+    }
+
+    // Converts pixels of the current line from line_colors into the framebuffer.
+    void PPU::expand_pixels(uint8_t x_pos, uint8_t count) {
+        auto &image = frames.back();
+        size_t pixel = (line_y * LCD_WIDTH) + x_pos;
+
+        if (pixel_format == PixelFormat::RGB565) {
+            for (uint8_t i = 0; i < count; ++i) {
+                std::memcpy(&image[(pixel + i) * 2], &palette_rgb565[line_colors[x_pos + i]], 2);
+            }
+
+            return;
         }
 
-        auto fb_pixel = std::span<uint8_t>{
-            &internal_framebuffer[(framebuffer_line_y + x_pos) * FRAMEBUFFER_COLOR_CHANNELS], 4};
+        pixel_kernels().expand(&line_colors[x_pos], palette_rgba.data(),
+                               &image[pixel * FRAMEBUFFER_COLOR_CHANNELS], count);
+    }
+
+    void PPU::update_palette_rgba(bool is_obj, uint8_t color) {
+        const auto &cram = is_obj ? obj_cram : bg_cram;
+        uint16_t value = cram[color * 2] | (cram[(color * 2) + 1] << 8);
 
-        auto r = color & 0x1F;
-        auto g = (color >> 5) & 0x1F;
-        auto b = (color >> 10) & 0x1F;
+        uint8_t index = (is_obj ? 32 : 0) + color;
+        palette_rgba[index] = (*color_lut)[value & 0x7FFF];
 
-        fb_pixel[0] = (r * 255) / 31;
-        fb_pixel[1] = (g * 255) / 31;
-        fb_pixel[2] = (b * 255) / 31;
-        fb_pixel[3] = 255;
+        std::array<uint8_t, 4> rgba{};
+        std::memcpy(rgba.data(), &palette_rgba[index], rgba.size());
+        palette_rgb565[index] = ((rgba[0] >> 3) << 11) | ((rgba[1] >> 2) << 5) | (rgba[2] >> 3);
     }
 
     void PPU::scan_oam() {
-        uint8_t height = (lcd_control & OBJECT_SIZE_BIT) ? 16 : 8;
+        uint64_t candidates = line_objects[(lcd_control & OBJECT_SIZE_BIT) ? 1 : 0][line_y];
 
         num_obj_on_scanline = 0;
-        objects_on_scanline.fill({});
-        for (int i = 0, total = 0; i < 40; ++i) {
-            if (total == 10) {
-                break;
-            }
+        while (candidates && (num_obj_on_scanline < 10)) {
+            int32_t i = std::countr_zero(candidates);
+            candidates &= candidates - 1;
 
             const Object *sprite = reinterpret_cast<const Object *>((&oam[i * 4]));
-            int32_t corrected_y_position = static_cast<int32_t>(sprite->y) - 16;
-
-            if (corrected_y_position <= line_y && (corrected_y_position + height) > line_y) {
-                objects_on_scanline[total] = *sprite;
-                total++;
-                num_obj_on_scanline++;
-            }
+            objects_on_scanline[num_obj_on_scanline++] = *sprite;
         }
 
         if (object_priority_mode & 0x1) {
@@ -864,6 +1194,32 @@ namespace GB {
         }
     }
 
+    // Moves an OAM entry to the lines covered by its new Y position.
+    void PPU::index_object(uint8_t object, uint8_t y) {
+        int32_t old_top = static_cast<int32_t>(oam[object * 4]) - 16;
+        int32_t new_top = static_cast<int32_t>(y) - 16;
+        uint64_t bit = uint64_t{1} << object;
+
+        if (old_top == new_top) {
+            return;
+        }
+
+        for (size_t size = 0; size < line_objects.size(); ++size) {
+            auto &lines = line_objects[size];
+            int32_t height = size ? 16 : 8;
+
+            for (int32_t line = std::max(old_top, 0); line < std::min(old_top + height, LCD_HEIGHT);
+                 ++line) {
+                lines[line] &= ~bit;
+            }
+
+            for (int32_t line = std::max(new_top, 0); line < std::min(new_top + height, LCD_HEIGHT);
+                 ++line) {
+                lines[line] |= bit;
+            }
+        }
+    }
+
     void PPU::set_mode(uint8_t mode) {
         mode &= 0x3;
         status &= ~0x3;
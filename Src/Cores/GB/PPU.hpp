@@ -18,6 +18,8 @@
 
 #pragma once
 #include "Constants.hpp"
+#include "FrameBuffer.hpp"
+#include "TileCache.hpp"
 #include <array>
 #include <cinttypes>
 #include <span>
@@ -30,6 +32,7 @@ namespace GB {
     constexpr uint8_t VBLANK = 0x1;
     constexpr uint8_t OAM_SEARCH = 0x2;
     constexpr uint8_t PIXEL_TRANSFER = 0x3;
+    constexpr int32_t DOTS_PER_LINE = 456;
 
     constexpr uint8_t LCD_ENABLED_BIT = 0x80;
     constexpr uint8_t WND_TILE_MAP_BIT = 0x40;
@@ -73,6 +76,11 @@ namespace GB {
         OBJ2,
     };
 
+    enum class PixelFormat {
+        RGBA8888,
+        RGB565,
+    };
+
     struct Object {
         uint8_t y = 0;
         uint8_t x = 0;
@@ -86,15 +94,14 @@ namespace GB {
         uint8_t pixels_left() const;
 
         void clear();
-        void load(uint8_t low, uint8_t high, uint8_t attribute);
+        void load(const TileCache::Row &row, uint8_t attribute);
         void force_shift(uint8_t amount);
         uint8_t clock();
 
     private:
         uint8_t shift_count = 0;
-        uint8_t pixels_low = 0;
-        uint8_t pixels_high = 0;
         uint8_t attribute = 0;
+        TileCache::Row pixels{};
     };
 
     class BackgroundFetcher {
@@ -104,16 +111,17 @@ namespace GB {
 
         void reset();
         void clear_with_mode(FetchMode new_mode);
-        void clock(PPU &ppu);
+        template <bool compat_mode> void clock(PPU &ppu);
 
     private:
-        void get_tile_id(PPU &ppu);
+        template <bool compat_mode> void get_tile_id(PPU &ppu);
         void get_tile_data(PPU &ppu, uint8_t bit_plane);
         void push_pixels(PPU &ppu);
 
         bool first_fetch = true;
         uint8_t substep = 0, tile_id = 0, attribute_id = 0;
         uint8_t queued_pixels_low = 0, queued_pixels_high = 0;
+        TileCache::Row queued_row{};
         uint16_t x_pos = 0, address = 0;
         FetchState state = FetchState::GetTileID;
         FetchMode mode = FetchMode::Background;
@@ -123,22 +131,33 @@ namespace GB {
     public:
         PPU(Core *core);
 
-        std::span<uint8_t, LCD_WIDTH * LCD_HEIGHT * 4> framebuffer();
+        // Last completed frame, 2 bytes per pixel in RGB565 and 4 otherwise. Only one thread may
+        // read frames, it need not be the one running the core.
+        std::span<uint8_t> framebuffer();
+        PixelFormat get_pixel_format() const;
 
         void reset();
         void set_post_boot_state();
         void set_compatibility_palette(PaletteID palette_type,
                                        const std::span<const uint16_t> colors);
 
+        // Selects the DMG (compatibility mode) or CGB pixel pipeline used by step().
+        void set_compatibility_mode(bool compat);
+        void set_color_correction(ColorCorrection mode);
+        void set_pixel_format(PixelFormat format);
+
         void step(int32_t accumulated_cycles);
+        void sync();
+        void schedule_next_event();
+        int32_t cycles_until_event() const;
 
         void write_register(uint8_t reg, uint8_t value);
-        uint8_t read_register(uint8_t reg) const;
+        uint8_t read_register(uint8_t reg);
 
         void write_vram(uint16_t address, uint8_t value);
-        uint8_t read_vram(uint16_t address) const;
+        uint8_t read_vram(uint16_t address);
         void write_oam(uint16_t address, uint8_t value);
-        uint8_t read_oam(uint16_t address) const;
+        uint8_t read_oam(uint16_t address);
 
     private:
         void write_bg_palette(uint8_t value);
@@ -151,19 +170,34 @@ namespace GB {
         void set_stat(uint8_t flags, bool value);
         bool stat_any() const;
 
-        void render_scanline();
-        void render_objects();
+        template <bool compat_mode> void step_pipeline(int32_t accumulated_cycles);
+        template <bool compat_mode> void render_scanline();
+        template <bool compat_mode> void render_line();
+        template <bool compat_mode> void resume_pixel_fifo();
+        template <bool compat_mode> void render_objects();
+        template <bool compat_mode>
+        void plot_background_pixel(uint8_t x_pos, uint8_t pixel, uint8_t attribute);
         void plot_cgb_pixel(uint8_t x_pos, uint8_t final_pixel, uint8_t palette, bool is_obj);
+        void expand_pixels(uint8_t x_pos, uint8_t count);
+        void update_palette_rgba(bool is_obj, uint8_t color);
+
+        int32_t cycles_until_vblank() const;
 
         void scan_oam();
+        void index_object(uint8_t object, uint8_t y);
         void set_mode(uint8_t mode);
         void check_ly_lyc(bool allow_interrupts);
 
+        void (PPU::*step_function)(int32_t accumulated_cycles) = &PPU::step_pipeline<false>;
+        void (PPU::*resume_function)() = &PPU::resume_pixel_fifo<false>;
+
         BackgroundFetcher fetcher;
         BackgroundFIFO bg_fifo;
 
         bool window_draw_flag = false;
         bool previously_disabled = false;
+        bool line_rendered = false;
+        bool palette_written = false;
 
         uint8_t num_obj_on_scanline = 0;
         uint8_t line_x = 0;
@@ -191,18 +225,29 @@ namespace GB {
 
         int32_t cycles = 0;
         int32_t extra_cycles = 0;
+        uint64_t synced_cycles = 0;
 
         std::array<uint8_t, 64> obj_cram{};
         std::array<uint8_t, 64> bg_cram{};
+        // BG colors followed by OBJ colors, as RGBA8888 in framebuffer byte order.
+        std::array<uint32_t, 64> palette_rgba{};
+        std::array<uint16_t, 64> palette_rgb565{};
+        PixelFormat pixel_format = PixelFormat::RGBA8888;
+        ColorCorrection color_correction = ColorCorrection::Raw;
+        const std::array<uint32_t, 32768> *color_lut = nullptr;
+        // Color of each pixel of the current line, as an index into palette_rgba.
+        std::array<uint8_t, LCD_WIDTH> line_colors{};
 
         std::array<uint8_t, 16384> vram{};
+        TileCache tile_cache;
 
         std::array<uint8_t, 256> oam{};
         std::array<Object, 10> objects_on_scanline{};
+        // Bit n is set on every line OAM entry n covers, for 8x8 and then 8x16 objects.
+        std::array<std::array<uint64_t, LCD_HEIGHT>, 2> line_objects{};
 
         std::array<uint16_t, LCD_WIDTH * LCD_HEIGHT> bg_color_table{};
-        std::array<uint8_t, LCD_WIDTH * LCD_HEIGHT * 4> internal_framebuffer{};
-        std::array<uint8_t, LCD_WIDTH * LCD_HEIGHT * 4> framebuffer_complete{};
+        FrameBuffer frames;
 
         Core *core;
 
@@ -0,0 +1,204 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "PixelKernels.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GB_PIXEL_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define GB_TARGET_AVX2
+#else
+#define GB_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace GB {
+    namespace {
+        [[maybe_unused]] void decode_tile_scalar(const uint8_t *planes, uint8_t *indices,
+                                                 uint8_t *flipped) {
+            for (size_t y = 0; y < 8; ++y) {
+                uint8_t low = planes[y * 2];
+                uint8_t high = planes[(y * 2) + 1];
+
+                for (size_t x = 0; x < 8; ++x) {
+                    uint8_t bit = 7 - x;
+                    uint8_t index = (((high >> bit) & 0x1) << 1) | ((low >> bit) & 0x1);
+
+                    indices[(y * 8) + x] = index;
+                    flipped[(y * 8) + (7 - x)] = index;
+                }
+            }
+        }
+
+        void expand_scalar(const uint8_t *indices, const uint32_t *palette, uint8_t *rgba,
+                           size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                std::memcpy(rgba + (i * 4), &palette[indices[i]], 4);
+            }
+        }
+
+#ifdef GB_PIXEL_KERNELS_X86
+        // Each byte of a plane repeated across the 8 bytes of a 64-bit lane.
+        constexpr uint64_t BROADCAST = 0x0101010101010101ull;
+        // Bit tested for each pixel of a lane, leftmost pixel first.
+        constexpr uint64_t PIXEL_BITS = 0x0102040810204080ull;
+        constexpr uint64_t PIXEL_BITS_FLIPPED = 0x8040201008040201ull;
+
+        __m128i decode_rows_sse2(__m128i low, __m128i high, __m128i bits) {
+            __m128i one = _mm_set1_epi8(1);
+            __m128i low_set = _mm_cmpeq_epi8(_mm_and_si128(low, bits), bits);
+            __m128i high_set = _mm_cmpeq_epi8(_mm_and_si128(high, bits), bits);
+
+            return _mm_or_si128(_mm_and_si128(low_set, one),
+                                _mm_and_si128(high_set, _mm_add_epi8(one, one)));
+        }
+
+        void decode_tile_sse2(const uint8_t *planes, uint8_t *indices, uint8_t *flipped) {
+            __m128i bits = _mm_set1_epi64x(static_cast<int64_t>(PIXEL_BITS));
+            __m128i bits_flipped = _mm_set1_epi64x(static_cast<int64_t>(PIXEL_BITS_FLIPPED));
+
+            for (size_t y = 0; y < 8; y += 2) {
+                const uint8_t *row = planes + (y * 2);
+                __m128i low = _mm_set_epi64x(static_cast<int64_t>(row[2] * BROADCAST),
+                                             static_cast<int64_t>(row[0] * BROADCAST));
+                __m128i high = _mm_set_epi64x(static_cast<int64_t>(row[3] * BROADCAST),
+                                              static_cast<int64_t>(row[1] * BROADCAST));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(indices + (y * 8)),
+                                 decode_rows_sse2(low, high, bits));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(flipped + (y * 8)),
+                                 decode_rows_sse2(low, high, bits_flipped));
+            }
+        }
+
+        // SSE2 has no gather, but building whole vectors still halves the number of stores.
+        void expand_sse2(const uint8_t *indices, const uint32_t *palette, uint8_t *rgba,
+                         size_t count) {
+            size_t i = 0;
+
+            for (; (i + 4) <= count; i += 4) {
+                __m128i pixels =
+                    _mm_set_epi32(static_cast<int32_t>(palette[indices[i + 3]]),
+                                  static_cast<int32_t>(palette[indices[i + 2]]),
+                                  static_cast<int32_t>(palette[indices[i + 1]]),
+                                  static_cast<int32_t>(palette[indices[i]]));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(rgba + (i * 4)), pixels);
+            }
+
+            expand_scalar(indices + i, palette, rgba + (i * 4), count - i);
+        }
+
+        GB_TARGET_AVX2 __m256i decode_rows_avx2(__m256i low, __m256i high, __m256i bits) {
+            __m256i one = _mm256_set1_epi8(1);
+            __m256i low_set = _mm256_cmpeq_epi8(_mm256_and_si256(low, bits), bits);
+            __m256i high_set = _mm256_cmpeq_epi8(_mm256_and_si256(high, bits), bits);
+
+            return _mm256_or_si256(_mm256_and_si256(low_set, one),
+                                   _mm256_and_si256(high_set, _mm256_add_epi8(one, one)));
+        }
+
+        GB_TARGET_AVX2 void decode_tile_avx2(const uint8_t *planes, uint8_t *indices,
+                                             uint8_t *flipped) {
+            __m256i bits = _mm256_set1_epi64x(static_cast<int64_t>(PIXEL_BITS));
+            __m256i bits_flipped = _mm256_set1_epi64x(static_cast<int64_t>(PIXEL_BITS_FLIPPED));
+
+            for (size_t y = 0; y < 8; y += 4) {
+                const uint8_t *row = planes + (y * 2);
+                __m256i low = _mm256_set_epi64x(static_cast<int64_t>(row[6] * BROADCAST),
+                                                static_cast<int64_t>(row[4] * BROADCAST),
+                                                static_cast<int64_t>(row[2] * BROADCAST),
+                                                static_cast<int64_t>(row[0] * BROADCAST));
+                __m256i high = _mm256_set_epi64x(static_cast<int64_t>(row[7] * BROADCAST),
+                                                 static_cast<int64_t>(row[5] * BROADCAST),
+                                                 static_cast<int64_t>(row[3] * BROADCAST),
+                                                 static_cast<int64_t>(row[1] * BROADCAST));
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(indices + (y * 8)),
+                                    decode_rows_avx2(low, high, bits));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(flipped + (y * 8)),
+                                    decode_rows_avx2(low, high, bits_flipped));
+            }
+        }
+
+        GB_TARGET_AVX2 void expand_avx2(const uint8_t *indices, const uint32_t *palette,
+                                        uint8_t *rgba, size_t count) {
+            const int *table = reinterpret_cast<const int *>(palette);
+            size_t i = 0;
+
+            for (; (i + 16) <= count; i += 16) {
+                __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + i));
+                __m256i first = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(packed), 4);
+                __m256i second = _mm256_i32gather_epi32(
+                    table, _mm256_cvtepu8_epi32(_mm_srli_si128(packed, 8)), 4);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + (i * 4)), first);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + (i * 4) + 32), second);
+            }
+
+            for (; (i + 8) <= count; i += 8) {
+                __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(indices + i));
+                __m256i pixels = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(packed), 4);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + (i * 4)), pixels);
+            }
+
+            expand_scalar(indices + i, palette, rgba + (i * 4), count - i);
+        }
+
+        bool cpu_supports_avx2() {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+
+            // AVX state has to be enabled by the OS as well as supported by the CPU.
+            __cpuid(info, 1);
+            bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                                ((_xgetbv(0) & 0x6) == 0x6);
+
+            __cpuidex(info, 7, 0);
+            return os_saves_ymm && (info[1] & (1 << 5));
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+
+        PixelKernels select_kernels() {
+#ifdef GB_PIXEL_KERNELS_X86
+            if (cpu_supports_avx2()) {
+                return {decode_tile_avx2, expand_avx2, "AVX2"};
+            }
+
+            return {decode_tile_sse2, expand_sse2, "SSE2"};
+#else
+            return {decode_tile_scalar, expand_scalar, "Scalar"};
+#endif
+        }
+    }
+
+    const PixelKernels &pixel_kernels() {
+        static const PixelKernels kernels = select_kernels();
+        return kernels;
+    }
+}
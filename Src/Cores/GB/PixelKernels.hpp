@@ -0,0 +1,42 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+
+namespace GB {
+    /*
+        Pixel conversion loops used by the PPU, with SSE2 and AVX2 versions on x86-64 that are
+        picked at runtime. Every implementation produces the same output as the scalar one.
+    */
+    struct PixelKernels {
+        // Decodes the 8 rows of a 16-byte 2bpp tile into 64 color indices, left to right, and
+        // into the same rows mirrored horizontally.
+        void (*decode_tile)(const uint8_t *planes, uint8_t *indices, uint8_t *flipped);
+
+        // Looks up each of count color indices in palette and stores the RGBA8888 result.
+        void (*expand)(const uint8_t *indices, const uint32_t *palette, uint8_t *rgba,
+                       size_t count);
+
+        const char *name;
+    };
+
+    // Fastest kernels the host CPU supports, selected on first use.
+    const PixelKernels &pixel_kernels();
+}
@@ -0,0 +1,127 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <string_view>
+
+namespace GB {
+    enum class ProfileComponent {
+        Timer,
+        Serial,
+        PPU,
+        APU,
+        DMA,
+        CPU,
+    };
+
+    constexpr size_t PROFILE_COMPONENT_COUNT = 6;
+
+    constexpr std::array<std::string_view, PROFILE_COMPONENT_COUNT> PROFILE_COMPONENT_NAMES{
+        "Timer::sync", "Serial::complete_transfer", "PPU::sync",
+        "APU::sync",   "DMAController::tick",       "SM83::step",
+    };
+
+    struct ComponentProfile {
+        uint64_t calls = 0;
+        uint64_t inclusive_ns = 0;
+        // Time spent in the component itself, excluding profiled components it called into.
+        uint64_t exclusive_ns = 0;
+    };
+
+    class ProfileScope;
+
+    class CoreProfile {
+    public:
+        bool enabled() const {
+#ifdef GB_ENABLE_PROFILER
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        uint64_t frames() const { return frames_; }
+
+        const ComponentProfile &component(ProfileComponent id) const {
+            return components[static_cast<size_t>(id)];
+        }
+
+        void reset() {
+            frames_ = 0;
+            components.fill({});
+        }
+
+    private:
+        uint64_t frames_ = 0;
+        std::array<ComponentProfile, PROFILE_COMPONENT_COUNT> components{};
+        ProfileScope *active_scope = nullptr;
+
+        friend class Core;
+        friend class ProfileScope;
+    };
+
+    class ProfileScope {
+    public:
+        ProfileScope(CoreProfile &profile, ProfileComponent id)
+            : profile(profile), parent(profile.active_scope),
+              data(profile.components[static_cast<size_t>(id)]),
+              start(std::chrono::steady_clock::now()) {
+            profile.active_scope = this;
+        }
+
+        ~ProfileScope() {
+            auto elapsed = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count());
+
+            data.calls++;
+            data.inclusive_ns += elapsed;
+            data.exclusive_ns += elapsed - children_ns;
+
+            if (parent) {
+                parent->children_ns += elapsed;
+            }
+
+            profile.active_scope = parent;
+        }
+
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &operator=(const ProfileScope &) = delete;
+
+    private:
+        CoreProfile &profile;
+        ProfileScope *parent;
+        ComponentProfile &data;
+        uint64_t children_ns = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+}
+
+#ifdef GB_ENABLE_PROFILER
+#define GB_PROFILE(profile, component, statement)                                                  \
+    do {                                                                                           \
+        GB::ProfileScope profile_scope{profile, component};                                        \
+        statement;                                                                                 \
+    } while (0)
+#else
+#define GB_PROFILE(profile, component, statement) statement
+#endif
@@ -20,12 +20,26 @@
 #include "Bus.hpp"
 #include "Constants.hpp"
 #include "Core.hpp"
+#include "OpcodeProfiler.hpp"
+#include <bit>
+#include <cstring>
 #include <stdexcept>
+#include <utility>
 
-#define GET_REG(R) registers[static_cast<size_t>(R)]
+#define GET_REG(R) registers[register_index(R)]
 
 namespace GB {
-    SM83::SM83(Core *core) : opcodes(gen_optable()), cb_opcodes(gen_cb_optable()), core(core) {
+    // B/C, D/E and H/L swap places in storage so pairs are little-endian in memory.
+    constexpr size_t register_index(Register r) {
+        auto index = static_cast<size_t>(r);
+        return index < 6 ? index ^ 1 : index;
+    }
+
+    constexpr size_t BC_INDEX = register_index(Register::C);
+    constexpr size_t DE_INDEX = register_index(Register::E);
+    constexpr size_t HL_INDEX = register_index(Register::L);
+
+    SM83::SM83(Core *core) : core(core) {
         if (!core) {
             throw std::invalid_argument("Core cannot be null.");
         }
@@ -44,6 +58,15 @@ namespace GB {
         interrupt_enable = 0;
         interrupt_flag = 0;
 
+        block_cache.clear();
+#ifdef GB_ENABLE_JIT
+        jit.clear();
+#endif
+        active_block = nullptr;
+        current_instruction = nullptr;
+        idle_loop_cached = false;
+        idle_iteration_free_ticks = 0;
+
         if (core->bus.is_compatibility_mode()) {
             set_flags(FLAG_N, false);
             set_flags(FLAG_Z, true);
@@ -78,21 +101,421 @@ namespace GB {
 
     void SM83::request_interrupt(uint8_t interrupt) { interrupt_flag |= interrupt; }
 
+    void SM83::set_opcode_profiler(OpcodeProfiler *new_profiler) { profiler = new_profiler; }
+
+    void SM83::set_block_cache_enabled(bool enabled) {
+        block_cache_enabled_ = enabled;
+        block_cache.clear();
+#ifdef GB_ENABLE_JIT
+        jit.clear();
+#endif
+        active_block = nullptr;
+    }
+
+    bool SM83::block_cache_enabled() const { return block_cache_enabled_; }
+
     void SM83::step() {
+        begin_step();
+        execute();
+    }
+
+    void SM83::begin_step() {
         service_interrupts();
 
         if (ei_delay_) {
             master_interrupt_enable_ = true;
             ei_delay_ = false;
         }
+    }
+
+    void SM83::execute() {
+        if (profiler) {
+            execute_profiled();
+            return;
+        }
+
+        if (halted_) {
+            step_halted();
+            return;
+        }
+
+        if (block_cache_enabled_) {
+            execute_cached();
+            return;
+        }
 
         uint8_t opcode = read(pc);
+        opcodes[opcode](*this);
+    }
+
+    void SM83::execute_profiled() {
+        uint16_t opcode_pc = pc;
+        int32_t bank = core->bus.rom_bank(opcode_pc);
+        uint64_t start_cycles = core->elapsed_cycles();
 
         if (halted_) {
+            step_halted();
+            profiler->record_halted(core->elapsed_cycles() - start_cycles);
+            return;
+        }
+
+        uint8_t opcode = read(pc);
+
+        opcodes[opcode](*this);
+        profiler->record(bank, opcode_pc, opcode, core->elapsed_cycles() - start_cycles);
+    }
+
+    // Nothing can wake the CPU before the next event, so skip straight to it instead of
+    // refetching the opcode after HALT every M-cycle. STOP needs no equivalent, it sets
+    // stopped_ which ends frame_in_progress() and the run loop stops stepping the CPU.
+    void SM83::step_halted() {
+        int32_t ticks = core->ticks_until_event();
+
+        if (ticks > 1) {
+            core->fast_forward(ticks);
+        } else {
+            read(pc);
+        }
+    }
+
+    void SM83::execute_cached() {
+        const DecodedInstruction *instruction = next_cached_instruction();
+
+        if (!instruction) {
+            uint8_t opcode = read(pc);
+            opcodes[opcode](*this);
+            return;
+        }
+
+#ifdef GB_ENABLE_JIT
+        DecodedBlock *entered_block = (active_index == 1) ? active_block : nullptr;
+        run_instruction(*instruction);
+
+        if (!entered_block || entered_block != active_block || in_native_block) {
+            return;
+        }
+
+        if (entered_block->native) {
+            in_native_block = true;
+            entered_block->native(*this);
+            in_native_block = false;
+        } else if (++entered_block->executions == JIT_HOT_THRESHOLD) {
+            entered_block->native = jit.compile(*entered_block);
+        }
+#else
+        run_instruction(*instruction);
+#endif
+    }
+
+    void SM83::run_instruction(const DecodedInstruction &instruction) {
+        current_instruction = &instruction;
+        core->tick_subcomponents(4);
+        instruction.handler(*this);
+        current_instruction = nullptr;
+    }
+
+#ifdef GB_ENABLE_JIT
+    // Called from native code between instructions; does the work of one iteration of
+    // Core::run_for_frames and returns false when the block has to be left.
+    bool SM83::jit_step(SM83 &cpu, const DecodedInstruction &instruction) {
+        if (!cpu.active_block || !cpu.core->frame_in_progress()) {
+            return false;
+        }
+
+        cpu.core->dma.tick();
+        cpu.begin_step();
+
+        // An interrupt was dispatched, or the mapping changed while pushing PC.
+        if (cpu.halted_ || cpu.pc != instruction.pc || !cpu.active_block) {
+            cpu.execute();
+            return false;
+        }
+
+        ++cpu.active_index;
+        cpu.run_instruction(instruction);
+        return true;
+    }
+
+    // Called from native code before a run of translated instructions. The run only touches
+    // CPU registers, so when no interrupt is taken before it and no event or frame end falls
+    // inside it, its M-cycles can be accounted for at once.
+    bool SM83::jit_enter(SM83 &cpu, const DecodedInstruction &first, int32_t count,
+                         int32_t ticks) {
+        if (!cpu.active_block || !cpu.core->frame_in_progress() || cpu.pc != first.pc ||
+            cpu.halted_ || cpu.ei_delay_) {
+            return false;
+        }
+
+        if ((cpu.interrupt_flag & cpu.interrupt_enable) && cpu.master_interrupt_enable_) {
+            return false;
+        }
+
+        if (cpu.core->ticks_until_deadline() < ticks) {
+            return false;
+        }
+
+        cpu.core->fast_forward(ticks);
+        cpu.active_index += count;
+        return true;
+    }
+
+    JitLayout SM83::jit_layout() const {
+        auto offset = [this](const void *member) {
+            return static_cast<int32_t>(static_cast<const uint8_t *>(member) -
+                                        reinterpret_cast<const uint8_t *>(this));
+        };
+
+        JitLayout layout;
+
+        for (size_t r = 0; r < layout.registers.size(); ++r) {
+            layout.registers[r] = offset(&registers[register_index(static_cast<Register>(r))]);
+        }
+
+        layout.pc = offset(&pc);
+        layout.z_result = offset(&z_result);
+        layout.n_flag = offset(&n_flag);
+        layout.h_bits = offset(&h_bits);
+        layout.c_bits = offset(&c_bits);
+        return layout;
+    }
+#endif
+
+    const DecodedInstruction *SM83::next_cached_instruction() {
+        if (active_block && active_index < active_block->instructions.size()) {
+            const DecodedInstruction &next = active_block->instructions[active_index];
+
+            if (next.pc == pc) {
+                ++active_index;
+                return &next;
+            }
+        }
+
+        active_block = nullptr;
+
+        // RAM-resident code and the bootstrap ROM are never cached.
+        if (pc >= 0x8000 || core->bus.bootstrap_mapped()) {
+            return nullptr;
+        }
+
+        int32_t bank = core->bus.rom_bank(pc);
+        DecodedBlock *block = block_cache.find(bank, pc);
+
+        if (!block) {
+            block = decode_block(bank, pc);
+        }
+
+        if (block->instructions.empty()) {
+            return nullptr;
+        }
+
+        active_block = block;
+        active_index = 1;
+        return &block->instructions[0];
+    }
+
+    DecodedBlock *SM83::decode_block(int32_t bank, uint16_t address) {
+        // Blocks never cross into the next 16KB window since it may be mapped to another bank.
+        uint32_t window_end = (address < 0x4000) ? 0x4000 : 0x8000;
+        uint32_t current = address;
+        DecodedBlock block;
+
+        while (block.instructions.size() < BLOCK_CACHE_MAX_INSTRUCTIONS) {
+            uint8_t opcode = core->bus.read(current);
+            uint8_t length = instruction_length(opcode);
+
+            if (current + length > window_end) {
+                break;
+            }
+
+            DecodedInstruction &instruction = block.instructions.emplace_back();
+            instruction.handler = opcodes[opcode];
+            instruction.pc = static_cast<uint16_t>(current);
+
+            for (uint8_t i = 0; i < length; ++i) {
+                instruction.bytes[i] = core->bus.read(current + i);
+            }
+
+            current += length;
+
+            if (ends_block(opcode)) {
+                break;
+            }
+        }
+
+        return &block_cache.insert(bank, address, std::move(block));
+    }
+
+    void SM83::rom_mapping_changed() {
+        // Cached blocks stay valid under their own bank, but the one being executed may no
+        // longer be the code mapped at PC.
+        active_block = nullptr;
+        idle_loop_cached = false;
+    }
+
+    /*
+        Recognizes loops that only load A from LY, STAT, IF or the joypad register, test it with
+        immediate ALU ops and branch back. Every iteration of such a loop does the same thing
+        until the polled register changes, and the cost of one iteration in M-cycles is returned
+        in ticks.
+    */
+    SM83::IdleLoop SM83::analyze_idle_loop(uint16_t target, uint16_t branch_pc) {
+        static constexpr uint16_t MAX_LOOP_BYTES = 32;
+
+        auto polled = [](uint16_t address) {
+            return address == 0xFF44 || address == 0xFF41 || address == 0xFF0F ||
+                   address == 0xFF00;
+        };
+
+        // A target after the branch wraps around to a large distance and is rejected too.
+        auto loop_bytes = static_cast<uint16_t>(branch_pc - target);
+
+        if (loop_bytes > MAX_LOOP_BYTES || (target >= 0xFE00 && target < 0xFF80)) {
+            return {};
+        }
+
+        uint16_t address = target;
+        int32_t ticks = 0;
+
+        // The loop has to reload A from the polled register before testing it.
+        switch (core->bus.read(address)) {
+        case 0xF0: {
+            if (!polled(0xFF00 | core->bus.read(address + 1))) {
+                return {};
+            }
+            ticks += 3;
+            address += 2;
+            break;
+        }
+        case 0xFA: {
+            uint16_t source = core->bus.read(address + 1) | (core->bus.read(address + 2) << 8);
+
+            if (!polled(source)) {
+                return {};
+            }
+            ticks += 4;
+            address += 3;
+            break;
+        }
+        default: {
+            return {};
+        }
+        }
+
+        while (address < branch_pc) {
+            switch (core->bus.read(address)) {
+            // cp, and, or, xor u8
+            case 0xFE:
+            case 0xE6:
+            case 0xF6:
+            case 0xEE: {
+                ticks += 2;
+                address += 2;
+                break;
+            }
+            // and a, or a
+            case 0xA7:
+            case 0xB7: {
+                ticks += 1;
+                address += 1;
+                break;
+            }
+            // bit n, a
+            case 0xCB: {
+                if ((core->bus.read(address + 1) & 0xC7) != 0x47) {
+                    return {};
+                }
+                ticks += 2;
+                address += 2;
+                break;
+            }
+            // jr cc, not taken
+            case 0x20:
+            case 0x28:
+            case 0x30:
+            case 0x38: {
+                ticks += 2;
+                address += 2;
+                break;
+            }
+            // jp cc, not taken
+            case 0xC2:
+            case 0xCA:
+            case 0xD2:
+            case 0xDA: {
+                ticks += 3;
+                address += 3;
+                break;
+            }
+            default: {
+                return {};
+            }
+            }
+        }
+
+        if (address != branch_pc) {
+            return {};
+        }
+
+        switch (core->bus.read(branch_pc)) {
+        case 0x18:
+        case 0x20:
+        case 0x28:
+        case 0x30:
+        case 0x38: {
+            return {true, ticks + 3};
+        }
+        case 0xC2:
+        case 0xC3:
+        case 0xCA:
+        case 0xD2:
+        case 0xDA: {
+            return {true, ticks + 4};
+        }
+        default: {
+            return {};
+        }
+        }
+    }
+
+    /*
+        Called after a backward branch has been taken. Once an idle loop has run a full
+        iteration without anything changing in the system, the remaining iterations up to the
+        next event are skipped, since they can only reproduce the same register state.
+    */
+    void SM83::check_idle_loop(uint16_t branch_pc) {
+        bool same_loop = (branch_pc == idle_loop_branch) && (pc == idle_loop_target);
+
+        if (!same_loop || !idle_loop_cached) {
+            idle_loop = analyze_idle_loop(pc, branch_pc);
+            // Code in RAM can be rewritten, so only ROM loops keep their analysis.
+            idle_loop_cached = (branch_pc < 0x8000);
+            idle_loop_branch = branch_pc;
+            idle_loop_target = pc;
+
+            if (!same_loop) {
+                idle_iteration_free_ticks = 0;
+            }
+        }
+
+        if (!idle_loop.idle) {
             return;
         }
 
-        (this->*opcodes.at(opcode))();
+        uint64_t tick_cycles = double_speed_ ? 2 : 4;
+        uint64_t iteration_cycles = idle_loop.ticks * tick_cycles;
+
+        // Anything else running in between (an interrupt handler) shows up as extra cycles.
+        if ((core->elapsed_cycles() - idle_iteration_start) == iteration_cycles &&
+            idle_iteration_free_ticks >= idle_loop.ticks) {
+            int32_t iterations = core->ticks_until_event() / idle_loop.ticks;
+
+            if (iterations > 0) {
+                core->fast_forward(iterations * idle_loop.ticks);
+            }
+        }
+
+        idle_iteration_start = core->elapsed_cycles();
+        idle_iteration_free_ticks = core->ticks_until_event();
     }
 
     void SM83::service_interrupts() {
@@ -165,6 +588,24 @@ namespace GB {
         return (static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(low);
     }
 
+    uint8_t SM83::fetch(uint16_t address) {
+        if (current_instruction) {
+            uint16_t offset = address - current_instruction->pc;
+
+            core->tick_subcomponents(4);
+            return current_instruction->bytes[offset];
+        }
+
+        return read(address);
+    }
+
+    uint16_t SM83::fetch_uint16(uint16_t address) {
+        uint8_t low = fetch(address);
+        uint8_t hi = fetch(address + 1);
+
+        return (static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(low);
+    }
+
     void SM83::write(uint16_t address, uint8_t value) {
         core->tick_subcomponents(4);
         core->bus.write(address, value);
@@ -187,62 +628,102 @@ namespace GB {
     }
 
     void SM83::set_flags(uint8_t flags, bool set) {
-        if (set) {
-            GET_REG(Register::F) |= flags;
+        if (flags & FLAG_Z) {
+            z_result = set ? 0 : 1;
+        }
+        if (flags & FLAG_N) {
+            n_flag = set;
+        }
+        if (flags & FLAG_HC) {
+            h_bits = set ? 0x10 : 0;
+        }
+        if (flags & FLAG_CY) {
+            c_bits = set ? 0x100 : 0;
+        }
+    }
+
+    bool SM83::get_flag(uint8_t flag) const {
+        switch (flag) {
+        case FLAG_Z: {
+            return z_result == 0;
+        }
+        case FLAG_N: {
+            return n_flag;
+        }
+        case FLAG_HC: {
+            return h_bits & 0x10;
+        }
+        default: {
+            return c_bits & 0x100;
+        }
+        }
+    }
+
+    uint8_t SM83::get_flags_register() const {
+        return (get_flag(FLAG_Z) ? FLAG_Z : 0) | (get_flag(FLAG_N) ? FLAG_N : 0) |
+               (get_flag(FLAG_HC) ? FLAG_HC : 0) | (get_flag(FLAG_CY) ? FLAG_CY : 0);
+    }
+
+    void SM83::set_flags_register(uint8_t value) {
+        set_flags(FLAG_Z, value & FLAG_Z);
+        set_flags(FLAG_N, value & FLAG_N);
+        set_flags(FLAG_HC, value & FLAG_HC);
+        set_flags(FLAG_CY, value & FLAG_CY);
+    }
+
+    uint16_t SM83::get_pair(size_t low_index) const {
+        if constexpr (std::endian::native == std::endian::little) {
+            uint16_t value;
+            std::memcpy(&value, &registers[low_index], sizeof(value));
+            return value;
         } else {
-            GET_REG(Register::F) &= ~flags;
+            return (registers[low_index + 1] << 8) | registers[low_index];
         }
     }
 
-    bool SM83::get_flag(uint8_t flag) const { return GET_REG(Register::F) & flag; }
+    void SM83::set_pair(size_t low_index, uint16_t value) {
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(&registers[low_index], &value, sizeof(value));
+        } else {
+            registers[low_index] = static_cast<uint8_t>(value & 0xFF);
+            registers[low_index + 1] = static_cast<uint8_t>(value >> 8);
+        }
+    }
 
     uint16_t SM83::get_rp(RegisterPair index) const {
-        uint16_t hi;
-        uint16_t low;
         switch (index) {
         case RegisterPair::BC: {
-            hi = GET_REG(Register::B);
-            low = GET_REG(Register::C);
-            break;
+            return get_pair(BC_INDEX);
         }
         case RegisterPair::DE: {
-            hi = GET_REG(Register::D);
-            low = GET_REG(Register::E);
-            break;
+            return get_pair(DE_INDEX);
         }
         case RegisterPair::HL: {
-            hi = GET_REG(Register::H);
-            low = GET_REG(Register::L);
-            break;
+            return get_pair(HL_INDEX);
         }
         case RegisterPair::SP: {
             return sp;
         }
         case RegisterPair::AF: {
-            hi = GET_REG(Register::A);
-            low = GET_REG(Register::F);
-            break;
+            return (GET_REG(Register::A) << 8) | get_flags_register();
         }
         }
 
-        return (hi << 8) | (low);
+        return 0;
     }
 
     void SM83::set_rp(RegisterPair index, uint16_t temp) {
         switch (index) {
         case RegisterPair::BC: {
-            GET_REG(Register::B) = static_cast<uint8_t>((temp & 0xFF00) >> 8);
-            GET_REG(Register::C) = static_cast<uint8_t>(temp & 0x00FF);
+            set_pair(BC_INDEX, temp);
             return;
         }
         case RegisterPair::DE: {
-            GET_REG(Register::D) = static_cast<uint8_t>((temp & 0xFF00) >> 8);
-            GET_REG(Register::E) = static_cast<uint8_t>(temp & 0x00FF);
+            set_pair(DE_INDEX, temp);
             return;
         }
         case RegisterPair::HL: {
-            GET_REG(Register::H) = static_cast<uint8_t>((temp & 0xFF00) >> 8);
-            GET_REG(Register::L) = static_cast<uint8_t>(temp & 0x00FF);
+            set_pair(HL_INDEX, temp);
             return;
         }
         case RegisterPair::SP: {
@@ -251,15 +732,14 @@ namespace GB {
         }
         case RegisterPair::AF: {
             GET_REG(Register::A) = static_cast<uint8_t>((temp & 0xFF00) >> 8);
-            GET_REG(Register::F) = static_cast<uint8_t>(temp & 0x00FF);
-            set_flags(0xF, false);
+            set_flags_register(static_cast<uint8_t>(temp & 0x00F0));
             return;
         }
         }
     }
 
     void SM83::op_ld_u16_sp() {
-        auto addr = read_uint16(pc + 1);
+        auto addr = fetch_uint16(pc + 1);
 
         write_uint16(addr, sp);
         pc += 3;
@@ -272,19 +752,27 @@ namespace GB {
         }
 
         if (KEY1 & 0x1) {
+            // The timer counts CPU cycles, so it has to be caught up before the rate changes.
+            core->timer.sync();
             double_speed_ = !double_speed_;
             KEY1 = double_speed_ << 7;
+            core->timer.schedule_next_event();
         }
 
         pc += 2;
     }
 
     void SM83::op_jr_i8() {
-        int8_t off = static_cast<int8_t>(read(pc + 1));
+        uint16_t branch_pc = pc;
+        int8_t off = static_cast<int8_t>(fetch(pc + 1));
 
         pc += 2;
         pc += off;
         core->tick_subcomponents(4);
+
+        if (off < 0) {
+            check_idle_loop(branch_pc);
+        }
     }
 
     void SM83::op_rlca() {
@@ -381,27 +869,37 @@ namespace GB {
     }
 
     void SM83::op_jp_u16() {
-        pc = read_uint16(pc + 1);
+        uint16_t branch_pc = pc;
+
+        pc = fetch_uint16(pc + 1);
         core->tick_subcomponents(4);
+
+        if (pc <= branch_pc) {
+            check_idle_loop(branch_pc);
+        }
     }
 
     void SM83::op_call_u16() {
         uint16_t saved_pc = pc + 3;
-        auto addr = read_uint16(pc + 1);
+        auto addr = fetch_uint16(pc + 1);
         core->tick_subcomponents(4);
         push_sp(saved_pc);
         pc = addr;
     }
 
     void SM83::op_cb() {
-        uint8_t opcode = read(pc + 1);
+        uint8_t opcode = fetch(pc + 1);
+
+        if (profiler) {
+            profiler->record_cb(opcode);
+        }
 
-        (this->*cb_opcodes.at(opcode))();
+        cb_opcodes[opcode](*this);
         pc += 2;
     }
 
     void SM83::op_ld_ff00_u8_a() {
-        uint8_t off = read(pc + 1);
+        uint8_t off = fetch(pc + 1);
         write(0xFF00 + off, GET_REG(Register::A));
         pc += 2;
     }
@@ -412,7 +910,7 @@ namespace GB {
     }
 
     void SM83::op_add_sp_i8() {
-        int16_t off = static_cast<int8_t>(read(pc + 1));
+        int16_t off = static_cast<int8_t>(fetch(pc + 1));
         uint16_t sp32 = sp;
         uint16_t res32 = (sp32 + off);
 
@@ -430,13 +928,13 @@ namespace GB {
     void SM83::op_jp_hl() { pc = get_rp(RegisterPair::HL); }
 
     void SM83::op_ld_u16_a() {
-        auto addr = read_uint16(pc + 1);
+        auto addr = fetch_uint16(pc + 1);
         write(addr, GET_REG(Register::A));
         pc += 3;
     }
 
     void SM83::op_ld_a_ff00_u8() {
-        uint16_t off = read(pc + 1);
+        uint16_t off = fetch(pc + 1);
         GET_REG(Register::A) = read(0xFF00 + off);
         pc += 2;
     }
@@ -458,7 +956,7 @@ namespace GB {
     }
 
     void SM83::op_ld_hl_sp_i8() {
-        int16_t off = static_cast<int8_t>(read(pc + 1));
+        int16_t off = static_cast<int8_t>(fetch(pc + 1));
         uint16_t sp32 = sp;
         uint16_t res32 = (sp32 + off);
         set_rp(RegisterPair::HL, static_cast<uint16_t>(res32 & 0xFFFF));
@@ -476,7 +974,7 @@ namespace GB {
     }
 
     void SM83::op_ld_a_u16() {
-        auto addr = read_uint16(pc + 1);
+        auto addr = fetch_uint16(pc + 1);
         GET_REG(Register::A) = read(addr);
         pc += 3;
     }
@@ -490,78 +988,22 @@ namespace GB {
     }
 
     template <RegisterPair rp> inline void SM83::op_ld_rp_u16() {
-        uint16_t combine = read_uint16(pc + 1);
+        uint16_t combine = fetch_uint16(pc + 1);
 
         set_rp(rp, combine);
         pc += 3;
     }
 
     template <RegisterPair rp> inline void SM83::op_inc_rp() {
-        auto increment = [this](uint8_t &high, uint8_t &low) {
-            uint16_t res = static_cast<uint16_t>(high) << 8 | static_cast<uint16_t>(low);
-
-            ++res;
-            high = static_cast<uint8_t>((res & 0xFF00) >> 8);
-            low = static_cast<uint8_t>(res & 0xFF);
-
-            core->tick_subcomponents(4);
-            ++pc;
-        };
-
-        switch (rp) {
-        case RegisterPair::BC: {
-            increment(GET_REG(Register::B), GET_REG(Register::C));
-            return;
-        }
-        case RegisterPair::DE: {
-            increment(GET_REG(Register::D), GET_REG(Register::E));
-            return;
-        }
-        case RegisterPair::HL: {
-            increment(GET_REG(Register::H), GET_REG(Register::L));
-            return;
-        }
-        case RegisterPair::SP: {
-            sp++;
-            core->tick_subcomponents(4);
-            ++pc;
-            return;
-        }
-        }
+        set_rp(rp, get_rp(rp) + 1);
+        core->tick_subcomponents(4);
+        ++pc;
     }
 
     template <RegisterPair rp> void SM83::op_dec_rp() {
-        const auto decrement = [this](uint8_t &high, uint8_t &low) {
-            uint16_t res = static_cast<uint16_t>(high) << 8 | static_cast<uint16_t>(low);
-
-            --res;
-            high = static_cast<uint8_t>((res & 0xFF00) >> 8);
-            low = static_cast<uint8_t>(res & 0xFF);
-
-            core->tick_subcomponents(4);
-            ++pc;
-        };
-
-        switch (rp) {
-        case RegisterPair::BC: {
-            decrement(GET_REG(Register::B), GET_REG(Register::C));
-            return;
-        }
-        case RegisterPair::DE: {
-            decrement(GET_REG(Register::D), GET_REG(Register::E));
-            return;
-        }
-        case RegisterPair::HL: {
-            decrement(GET_REG(Register::H), GET_REG(Register::L));
-            return;
-        }
-        case RegisterPair::SP: {
-            sp--;
-            core->tick_subcomponents(4);
-            ++pc;
-            return;
-        }
-        }
+        set_rp(rp, get_rp(rp) - 1);
+        core->tick_subcomponents(4);
+        ++pc;
     }
 
     template <RegisterPair rp, int16_t displacement> inline void SM83::op_ld_rp_a() {
@@ -577,11 +1019,16 @@ namespace GB {
 
     template <uint8_t cc, bool boolean_ver> inline void SM83::op_jr_cc_i8() {
         if (get_flag(cc) == boolean_ver) {
-            int8_t off = static_cast<int8_t>(read(pc + 1));
+            uint16_t branch_pc = pc;
+            int8_t off = static_cast<int8_t>(fetch(pc + 1));
 
             pc += 2;
             pc += off;
             core->tick_subcomponents(4);
+
+            if (off < 0) {
+                check_idle_loop(branch_pc);
+            }
             return;
         }
         core->tick_subcomponents(4);
@@ -593,9 +1040,9 @@ namespace GB {
         int32_t right = get_rp(rp);
         int32_t res32 = left + right;
 
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_HC, ((left & 0xFFF) + (right & 0xFFF)) > 0xFFF);
-        set_flags(FLAG_CY, res32 > 0xFFFF);
+        n_flag = false;
+        h_bits = static_cast<uint8_t>((left ^ right ^ res32) >> 8);
+        c_bits = static_cast<uint16_t>(res32 >> 8);
         set_rp(RegisterPair::HL, static_cast<uint16_t>(res32 & 0xFFFF));
 
         this->core->tick_subcomponents(4);
@@ -615,9 +1062,9 @@ namespace GB {
         auto result = left + right;
         auto masked_result = result & 0xFF;
 
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_HC, ((left & 0xF) + (right & 0xF)) > 0xF);
+        z_result = static_cast<uint8_t>(masked_result);
+        n_flag = false;
+        h_bits = static_cast<uint8_t>(left ^ right ^ result);
 
         if constexpr (r == Register::HL_ADDR) {
             write(get_rp(RegisterPair::HL), static_cast<uint8_t>(masked_result));
@@ -640,9 +1087,9 @@ namespace GB {
         auto result = left - right;
         auto masked_result = result & 0xFF;
 
-        set_flags(FLAG_HC, ((left & 0xF) - (right & 0xF)) < 0);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_N, true); // only set if subtraction
+        z_result = static_cast<uint8_t>(masked_result);
+        n_flag = true;
+        h_bits = static_cast<uint8_t>(left ^ right ^ result);
 
         if constexpr (r == Register::HL_ADDR) {
             write(get_rp(RegisterPair::HL), static_cast<uint8_t>(masked_result));
@@ -654,9 +1101,9 @@ namespace GB {
 
     template <Register r> void SM83::op_ld_r_u8() {
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), read(pc + 1));
+            write(get_rp(RegisterPair::HL), fetch(pc + 1));
         } else {
-            GET_REG(r) = read(pc + 1);
+            GET_REG(r) = fetch(pc + 1);
         }
         pc += 2;
     }
@@ -694,7 +1141,7 @@ namespace GB {
         if constexpr (r == Register::HL_ADDR) {
             right = static_cast<uint16_t>(read(get_rp(RegisterPair::HL)));
         } else if constexpr (r == Register::U8) {
-            right = static_cast<uint16_t>(read(pc + 1));
+            right = static_cast<uint16_t>(fetch(pc + 1));
             ++pc;
         } else {
             right = static_cast<uint16_t>(GET_REG(r));
@@ -705,10 +1152,10 @@ namespace GB {
         uint16_t result = left + right + cy;
         uint8_t masked_result = result & 0xFF;
 
-        set_flags(FLAG_HC, ((left & 0xF) + (right & 0xF) + (cy & 0xF)) > 0xF);
-        set_flags(FLAG_CY, result > 0xFF);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_N, false);
+        z_result = masked_result;
+        n_flag = false;
+        h_bits = static_cast<uint8_t>(left ^ right ^ result);
+        c_bits = result;
 
         GET_REG(Register::A) = masked_result;
         ++pc;
@@ -721,7 +1168,7 @@ namespace GB {
         if constexpr (r == Register::HL_ADDR) {
             right = static_cast<int16_t>(read(get_rp(RegisterPair::HL)));
         } else if constexpr (r == Register::U8) {
-            right = static_cast<int16_t>(read(pc + 1));
+            right = static_cast<int16_t>(fetch(pc + 1));
             ++pc;
         } else {
             right = static_cast<int16_t>(GET_REG(r));
@@ -732,10 +1179,10 @@ namespace GB {
         int16_t result = static_cast<int16_t>(left - right - cy);
         uint8_t masked_result = result & 0xFF;
 
-        set_flags(FLAG_HC, ((left & 0xF) - (right & 0xF) - (cy & 0xF)) < 0);
-        set_flags(FLAG_CY, result < 0);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_N, true);
+        z_result = masked_result;
+        n_flag = true;
+        h_bits = static_cast<uint8_t>(left ^ right ^ result);
+        c_bits = static_cast<uint16_t>(result);
 
         GET_REG(Register::A) = masked_result;
         ++pc;
@@ -747,17 +1194,17 @@ namespace GB {
         if constexpr (r == Register::HL_ADDR) {
             right = read(get_rp(RegisterPair::HL));
         } else if constexpr (r == Register::U8) {
-            right = read(pc + 1);
+            right = fetch(pc + 1);
             ++pc;
         } else {
             right = GET_REG(r);
         }
 
         uint8_t result = GET_REG(Register::A) & right;
-        set_flags(FLAG_Z, result == 0);
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_HC, true);
-        set_flags(FLAG_CY, false);
+        z_result = result;
+        n_flag = false;
+        h_bits = 0x10;
+        c_bits = 0;
 
         GET_REG(Register::A) = result;
         ++pc;
@@ -769,17 +1216,17 @@ namespace GB {
         if constexpr (r == Register::HL_ADDR) {
             right = read(get_rp(RegisterPair::HL));
         } else if constexpr (r == Register::U8) {
-            right = read(pc + 1);
+            right = fetch(pc + 1);
             ++pc;
         } else {
             right = GET_REG(r);
         }
 
         uint8_t result = GET_REG(Register::A) ^ right;
-        set_flags(FLAG_Z, result == 0);
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_HC, false);
-        set_flags(FLAG_CY, false);
+        z_result = result;
+        n_flag = false;
+        h_bits = 0;
+        c_bits = 0;
 
         GET_REG(Register::A) = result;
         ++pc;
@@ -791,17 +1238,17 @@ namespace GB {
         if constexpr (r == Register::HL_ADDR) {
             right = read(get_rp(RegisterPair::HL));
         } else if constexpr (r == Register::U8) {
-            right = read(pc + 1);
+            right = fetch(pc + 1);
             ++pc;
         } else {
             right = GET_REG(r);
         }
 
         uint8_t result = GET_REG(Register::A) | right;
-        set_flags(FLAG_Z, result == 0);
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_HC, false);
-        set_flags(FLAG_CY, false);
+        z_result = result;
+        n_flag = false;
+        h_bits = 0;
+        c_bits = 0;
 
         GET_REG(Register::A) = result;
         ++pc;
@@ -813,19 +1260,18 @@ namespace GB {
         if constexpr (r == Register::HL_ADDR) {
             right = read(get_rp(RegisterPair::HL));
         } else if constexpr (r == Register::U8) {
-            right = read(pc + 1);
+            right = fetch(pc + 1);
             ++pc;
         } else {
             right = GET_REG(r);
         }
 
         int16_t result = GET_REG(Register::A) - right;
-        uint8_t masked_result = result & 0xFF;
 
-        set_flags(FLAG_HC, ((GET_REG(Register::A) & 0xF) - (right & 0xF)) < 0);
-        set_flags(FLAG_CY, result < 0);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_N, true);
+        z_result = static_cast<uint8_t>(result);
+        n_flag = true;
+        h_bits = static_cast<uint8_t>(GET_REG(Register::A) ^ right ^ result);
+        c_bits = static_cast<uint16_t>(result);
 
         // Register::A is not modified, same as subtract without carry
         ++pc;
@@ -852,8 +1298,14 @@ namespace GB {
 
     template <uint8_t cc, bool boolean_ver> void SM83::op_jp_cc_u16() {
         if (get_flag(cc) == boolean_ver) {
-            pc = read_uint16(pc + 1);
+            uint16_t branch_pc = pc;
+
+            pc = fetch_uint16(pc + 1);
             core->tick_subcomponents(4);
+
+            if (pc <= branch_pc) {
+                check_idle_loop(branch_pc);
+            }
             return;
         }
 
@@ -864,7 +1316,7 @@ namespace GB {
     template <uint8_t cc, bool boolean_ver> void SM83::op_call_cc_u16() {
         if (get_flag(cc) == boolean_ver) {
             auto saved_pc = pc + 3;
-            auto addr = read_uint16(pc + 1);
+            auto addr = fetch_uint16(pc + 1);
             core->tick_subcomponents(4);
             push_sp(saved_pc);
             pc = addr;
@@ -1108,7 +1560,7 @@ namespace GB {
         }
     }
 
-    std::array<SM83::opcode_function, 256> SM83::gen_optable() {
+    constexpr std::array<SM83::opcode_function, 256> SM83::gen_optable() {
         constexpr int16_t NoDisplacement = 0;
         constexpr int16_t Increment = 1;
         constexpr int16_t Decrement = -1;
@@ -1410,7 +1862,7 @@ namespace GB {
         };
     }
 
-    std::array<SM83::opcode_function, 256> SM83::gen_cb_optable() {
+    constexpr std::array<SM83::opcode_function, 256> SM83::gen_cb_optable() {
         return std::array<SM83::opcode_function, 256>{
             // 0x00 - 0x0F
             &SM83::op_rlc<Register::B>,
@@ -1718,4 +2170,18 @@ namespace GB {
         };
     }
 
+    template <SM83::opcode_function op> void SM83::dispatch(SM83 &cpu) { (cpu.*op)(); }
+
+    template <bool cb_table, std::size_t... opcode>
+    constexpr std::array<SM83::opcode_handler, 256>
+    SM83::gen_handlers(std::index_sequence<opcode...>) {
+        constexpr auto table = cb_table ? gen_cb_optable() : gen_optable();
+
+        return {&dispatch<table[opcode]>...};
+    }
+
+    constinit const std::array<SM83::opcode_handler, 256> SM83::opcodes =
+        gen_handlers<false>(std::make_index_sequence<256>{});
+    constinit const std::array<SM83::opcode_handler, 256> SM83::cb_opcodes =
+        gen_handlers<true>(std::make_index_sequence<256>{});
 }
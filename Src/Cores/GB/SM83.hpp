@@ -17,11 +17,18 @@
 */
 
 #pragma once
+#include "BlockCache.hpp"
+#ifdef GB_ENABLE_JIT
+#include "Jit.hpp"
+#endif
 #include <array>
 #include <cinttypes>
+#include <cstddef>
+#include <utility>
 
 namespace GB {
     class Core;
+    class OpcodeProfiler;
 
     enum class Register {
         B = 0,
@@ -58,13 +65,43 @@ namespace GB {
 
         void reset(uint16_t new_pc);
         void request_interrupt(uint8_t interrupt);
+        void set_opcode_profiler(OpcodeProfiler *new_profiler);
+        // Executes ROM code from pre-decoded basic blocks instead of fetching through the bus.
+        void set_block_cache_enabled(bool enabled);
+        bool block_cache_enabled() const;
         void step();
 
     private:
+        void begin_step();
+        void execute();
         void service_interrupts();
+        void execute_profiled();
+        void step_halted();
+        void execute_cached();
+        void run_instruction(const DecodedInstruction &instruction);
+        const DecodedInstruction *next_cached_instruction();
+        DecodedBlock *decode_block(int32_t bank, uint16_t address);
+        void rom_mapping_changed();
+
+        struct IdleLoop {
+            bool idle = false;
+            int32_t ticks = 0;
+        };
+
+        IdleLoop analyze_idle_loop(uint16_t target, uint16_t branch_pc);
+        void check_idle_loop(uint16_t branch_pc);
+#ifdef GB_ENABLE_JIT
+        static bool jit_step(SM83 &cpu, const DecodedInstruction &instruction);
+        static bool jit_enter(SM83 &cpu, const DecodedInstruction &first, int32_t count,
+                              int32_t ticks);
+        JitLayout jit_layout() const;
+#endif
 
         uint8_t read(uint16_t address);
         uint16_t read_uint16(uint16_t address);
+        // Operand reads; served from the decoded instruction when executing from the cache.
+        uint8_t fetch(uint16_t address);
+        uint16_t fetch_uint16(uint16_t address);
         void write(uint16_t address, uint8_t value);
         void write_uint16(uint16_t address, uint16_t value);
 
@@ -72,6 +109,10 @@ namespace GB {
         uint16_t pop_sp();
         void set_flags(uint8_t flags, bool set);
         bool get_flag(uint8_t flag) const;
+        uint8_t get_flags_register() const;
+        void set_flags_register(uint8_t value);
+        uint16_t get_pair(size_t low_index) const;
+        void set_pair(size_t low_index, uint16_t value);
         uint16_t get_rp(RegisterPair index) const;
         void set_rp(RegisterPair index, uint16_t value);
 
@@ -148,25 +189,57 @@ namespace GB {
         template <uint8_t bit, Register r> void op_set();
 
         using opcode_function = void (SM83::*)();
-        static std::array<SM83::opcode_function, 256> gen_optable();
-        static std::array<SM83::opcode_function, 256> gen_cb_optable();
+        using opcode_handler = void (*)(SM83 &cpu);
+        static constexpr std::array<SM83::opcode_function, 256> gen_optable();
+        static constexpr std::array<SM83::opcode_function, 256> gen_cb_optable();
+
+        template <opcode_function op> static void dispatch(SM83 &cpu);
+        template <bool cb_table, std::size_t... opcode>
+        static constexpr std::array<opcode_handler, 256>
+        gen_handlers(std::index_sequence<opcode...>);
+
+        // Built at compile time and shared by every instance.
+        static const std::array<opcode_handler, 256> opcodes;
+        static const std::array<opcode_handler, 256> cb_opcodes;
 
         bool master_interrupt_enable_ = true;
         bool halted_ = false;
         bool ei_delay_ = false;
         bool stopped_ = false;
         bool double_speed_ = false;
+        bool block_cache_enabled_ = false;
 
         uint8_t interrupt_flag = 0, interrupt_enable = 0;
         uint8_t KEY1 = 0;
 
         uint16_t sp = 0xFFFF, pc = 0;
+        // Stored C, B, E, D, L, H, (unused), A so that each pair reads as one 16-bit value.
         std::array<uint8_t, 8> registers{};
 
-        std::array<opcode_function, 256> opcodes;
-        std::array<opcode_function, 256> cb_opcodes;
+        // Flags are kept in the form the ALU produces them and only packed into F when read:
+        // Z is set while z_result is 0, H is bit 4 of h_bits and C is bit 8 of c_bits.
+        uint8_t z_result = 0;
+        bool n_flag = false;
+        uint8_t h_bits = 0;
+        uint16_t c_bits = 0;
 
         Core *core;
+        OpcodeProfiler *profiler = nullptr;
+
+        IdleLoop idle_loop{};
+        bool idle_loop_cached = false;
+        uint16_t idle_loop_branch = 0, idle_loop_target = 0;
+        uint64_t idle_iteration_start = 0;
+        int32_t idle_iteration_free_ticks = 0;
+
+        BlockCache block_cache;
+        DecodedBlock *active_block = nullptr;
+        size_t active_index = 0;
+        const DecodedInstruction *current_instruction = nullptr;
+#ifdef GB_ENABLE_JIT
+        JitCompiler jit{&SM83::jit_step, &SM83::jit_enter, jit_layout()};
+        bool in_native_block = false;
+#endif
 
         friend class MainBus;
     };
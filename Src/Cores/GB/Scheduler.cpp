@@ -0,0 +1,87 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Scheduler.hpp"
+#include <algorithm>
+
+namespace GB {
+    constexpr size_t SCHEDULER_COMPACT_SIZE = 64;
+
+    void Scheduler::reset() {
+        heap.clear();
+        generation.fill(0);
+        pending.fill(false);
+    }
+
+    void Scheduler::schedule(EventType type, uint64_t timestamp) {
+        auto index = static_cast<size_t>(type);
+
+        // Repeated rescheduling before anything becomes due would otherwise grow the heap.
+        if (heap.size() >= SCHEDULER_COMPACT_SIZE) {
+            std::erase_if(heap, [this](const Event &event) { return is_stale(event); });
+            std::make_heap(heap.begin(), heap.end(), later);
+        }
+
+        pending[index] = true;
+        heap.push_back({timestamp, ++generation[index], type});
+        std::push_heap(heap.begin(), heap.end(), later);
+        discard_stale();
+    }
+
+    void Scheduler::cancel(EventType type) {
+        auto index = static_cast<size_t>(type);
+
+        if (pending[index]) {
+            pending[index] = false;
+            ++generation[index];
+            discard_stale();
+        }
+    }
+
+    bool Scheduler::is_scheduled(EventType type) const {
+        return pending[static_cast<size_t>(type)];
+    }
+
+    bool Scheduler::pop_due(uint64_t now, EventType &type) {
+        if (heap.empty() || heap.front().timestamp > now) {
+            return false;
+        }
+
+        type = heap.front().type;
+        pending[static_cast<size_t>(type)] = false;
+        std::pop_heap(heap.begin(), heap.end(), later);
+        heap.pop_back();
+        discard_stale();
+        return true;
+    }
+
+    void Scheduler::discard_stale() {
+        while (!heap.empty() && is_stale(heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            heap.pop_back();
+        }
+    }
+
+    bool Scheduler::later(const Event &lhs, const Event &rhs) {
+        return lhs.timestamp > rhs.timestamp;
+    }
+
+    bool Scheduler::is_stale(const Event &event) const {
+        auto index = static_cast<size_t>(event.type);
+        return !pending[index] || event.generation != generation[index];
+    }
+}
@@ -0,0 +1,74 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace GB {
+    /*
+        Deadlines that components register with the scheduler. A component handles its own
+        catch-up when the CPU touches one of its registers, the scheduler only has to wake it up
+        for things the CPU could observe without doing so (interrupts, transfer completion).
+    */
+    enum class EventType : uint8_t {
+        SerialTransfer,
+        PPU,
+        Timer,
+        Count,
+    };
+
+    constexpr size_t EVENT_TYPE_COUNT = static_cast<size_t>(EventType::Count);
+    constexpr uint64_t NO_DEADLINE = std::numeric_limits<uint64_t>::max();
+
+    // Min-heap of pending events keyed by master clock timestamp, one pending event per type.
+    class Scheduler {
+    public:
+        void reset();
+
+        // Replaces any pending event of the same type.
+        void schedule(EventType type, uint64_t timestamp);
+        void cancel(EventType type);
+        bool is_scheduled(EventType type) const;
+
+        // Pops the earliest event if it is due at or before now.
+        bool pop_due(uint64_t now, EventType &type);
+
+        uint64_t next_deadline() const {
+            return heap.empty() ? NO_DEADLINE : heap.front().timestamp;
+        }
+
+    private:
+        struct Event {
+            uint64_t timestamp;
+            uint32_t generation;
+            EventType type;
+        };
+
+        static bool later(const Event &lhs, const Event &rhs);
+        void discard_stale();
+        bool is_stale(const Event &event) const;
+
+        // Cancelled and rescheduled events stay in the heap until they reach the top.
+        std::vector<Event> heap;
+        std::array<uint32_t, EVENT_TYPE_COUNT> generation{};
+        std::array<bool, EVENT_TYPE_COUNT> pending{};
+    };
+}
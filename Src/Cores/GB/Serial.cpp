@@ -0,0 +1,118 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Serial.hpp"
+#include "Core.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace GB {
+    Serial::Serial(Core *core) : core(core) {
+        if (!core) {
+            throw std::invalid_argument("Core cannot be null.");
+        }
+    }
+
+    void Serial::reset() {
+        sb = 0;
+        sc = 0;
+        transfer_value = 0;
+        transferring = false;
+        bits_shifted = 0;
+        transfer_start = 0;
+        cycles_per_bit = SERIAL_CYCLES_PER_BIT;
+        core->scheduler.cancel(EventType::SerialTransfer);
+    }
+
+    void Serial::set_transfer_callback(std::function<void(uint8_t value)> cb) {
+        transfer_complete_func = cb;
+    }
+
+    uint8_t Serial::read_register(uint8_t reg) {
+        switch (reg) {
+        case 0x01:
+            sync();
+            return sb;
+        case 0x02:
+            // The clock speed bit only exists on CGB.
+            return sc | (core->bus.is_compatibility_mode() ? 0x7E : 0x7C);
+        }
+        return 0xFF;
+    }
+
+    void Serial::write_register(uint8_t reg, uint8_t value) {
+        sync();
+
+        switch (reg) {
+        case 0x01: {
+            sb = value;
+            return;
+        }
+        case 0x02: {
+            sc = value & 0x83;
+
+            if ((sc & 0x81) == 0x81) {
+                start_transfer();
+            } else {
+                transferring = false;
+                core->scheduler.cancel(EventType::SerialTransfer);
+            }
+            return;
+        }
+        }
+    }
+
+    void Serial::start_transfer() {
+        bool fast_clock = !core->bus.is_compatibility_mode() && (sc & 0x2);
+        uint64_t bit_period = fast_clock ? SERIAL_FAST_CYCLES_PER_BIT : SERIAL_CYCLES_PER_BIT;
+
+        // The shift clock is derived from the CPU clock, so it doubles along with it.
+        cycles_per_bit = core->cpu.double_speed() ? bit_period / 2 : bit_period;
+        transfer_value = sb;
+        transferring = true;
+        bits_shifted = 0;
+        transfer_start = core->elapsed_cycles();
+        core->scheduler.schedule(EventType::SerialTransfer, transfer_start + 8 * cycles_per_bit);
+    }
+
+    // Shifts in every bit that finished since the last access.
+    void Serial::sync() {
+        if (!transferring) {
+            return;
+        }
+
+        uint64_t elapsed_bits = (core->elapsed_cycles() - transfer_start) / cycles_per_bit;
+        int32_t bits = static_cast<int32_t>(std::min<uint64_t>(elapsed_bits, 8));
+
+        for (; bits_shifted < bits; ++bits_shifted) {
+            // With no link partner every incoming bit reads as 1.
+            sb = (sb << 1) | 1;
+        }
+    }
+
+    // Only internally clocked transfers complete, nothing is ever connected to the port.
+    void Serial::complete_transfer() {
+        sync();
+        transferring = false;
+        sc &= 0x7F;
+        core->cpu.request_interrupt(INT_SERIAL_PORT_BIT);
+
+        if (transfer_complete_func) {
+            transfer_complete_func(transfer_value);
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <cinttypes>
+#include <functional>
+
+namespace GB {
+    class Core;
+
+    constexpr int32_t SERIAL_CYCLES_PER_BIT = 512;
+    constexpr int32_t SERIAL_FAST_CYCLES_PER_BIT = 16;
+
+    class Serial {
+    public:
+        Serial(Core *core);
+
+        void reset();
+        void set_transfer_callback(std::function<void(uint8_t value)> cb);
+
+        uint8_t read_register(uint8_t reg);
+        void write_register(uint8_t reg, uint8_t value);
+        void complete_transfer();
+
+    private:
+        void start_transfer();
+        void sync();
+
+        Core *core;
+        uint8_t sb = 0;
+        uint8_t sc = 0;
+        uint8_t transfer_value = 0;
+        bool transferring = false;
+        int32_t bits_shifted = 0;
+        uint64_t transfer_start = 0;
+        uint64_t cycles_per_bit = SERIAL_CYCLES_PER_BIT;
+
+        std::function<void(uint8_t value)> transfer_complete_func = nullptr;
+    };
+}
@@ -0,0 +1,46 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "TileCache.hpp"
+#include "PixelKernels.hpp"
+
+namespace GB {
+    void TileCache::decode(uint8_t low, uint8_t high, bool flip_x, Row &row) {
+        for (uint8_t x = 0; x < 8; ++x) {
+            uint8_t bit = flip_x ? x : (7 - x);
+            row[x] = (((high >> bit) & 0x1) << 1) | ((low >> bit) & 0x1);
+        }
+    }
+
+    void TileCache::reset() { dirty.set(); }
+
+    void TileCache::invalidate(uint16_t address) {
+        // Tile maps and attributes live above the tile data and are never cached.
+        if ((address & 0x1FFF) < (TILES_PER_BANK * 16)) {
+            dirty.set(tile_index(address));
+        }
+    }
+
+    void TileCache::decode_tile(const std::array<uint8_t, 16384> &vram, size_t tile) {
+        size_t base = ((tile / TILES_PER_BANK) * 0x2000) + ((tile % TILES_PER_BANK) * 16);
+
+        pixel_kernels().decode_tile(&vram[base], rows[tile * 8].data(),
+                                    flipped_rows[tile * 8].data());
+        dirty.reset(tile);
+    }
+}
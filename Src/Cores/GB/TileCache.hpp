@@ -0,0 +1,66 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <array>
+#include <bitset>
+#include <cinttypes>
+#include <cstddef>
+
+namespace GB {
+    // 16-byte tiles in the 0x8000-0x97FF tile data area of one VRAM bank.
+    constexpr size_t TILES_PER_BANK = 384;
+
+    /*
+        Tile rows of both VRAM banks decoded from 2bpp planes into one color index per pixel,
+        alongside an X-flipped copy. A VRAM write only marks its tile dirty, the tile is decoded
+        again the next time one of its rows is drawn.
+    */
+    class TileCache {
+    public:
+        using Row = std::array<uint8_t, 8>;
+
+        static void decode(uint8_t low, uint8_t high, bool flip_x, Row &row);
+
+        void reset();
+        void invalidate(uint16_t address);
+
+        // Row whose low plane is at address (bank * 0x2000 + offset into the bank).
+        const Row &row(const std::array<uint8_t, 16384> &vram, uint16_t address, bool flip_x) {
+            size_t tile = tile_index(address);
+
+            if (dirty[tile]) {
+                decode_tile(vram, tile);
+            }
+
+            size_t row = (tile * 8) + ((address >> 1) & 0x7);
+            return flip_x ? flipped_rows[row] : rows[row];
+        }
+
+    private:
+        static size_t tile_index(uint16_t address) {
+            return ((address >> 13) * TILES_PER_BANK) + ((address & 0x1FFF) >> 4);
+        }
+
+        void decode_tile(const std::array<uint8_t, 16384> &vram, size_t tile);
+
+        std::array<Row, TILES_PER_BANK * 2 * 8> rows{};
+        std::array<Row, TILES_PER_BANK * 2 * 8> flipped_rows{};
+        std::bitset<TILES_PER_BANK * 2> dirty;
+    };
+}
@@ -18,6 +18,7 @@
 
 #include "Timer.hpp"
 #include "Core.hpp"
+#include <algorithm>
 #include <array>
 #include <stdexcept>
 
@@ -30,18 +31,20 @@ namespace GB {
         if (!core) {
             throw std::invalid_argument("Core cannot be null.");
         }
-
-        reset();
     }
 
     void Timer::write_register(uint8_t reg, uint8_t value) {
+        sync();
+
         switch (reg) {
         case 0x04: {
             reset_div();
+            schedule_next_event();
             return;
         }
         case 0x05: {
             tima = value;
+            schedule_next_event();
             return;
         }
         case 0x06: {
@@ -50,12 +53,15 @@ namespace GB {
         }
         case 0x07: {
             set_tac(value);
+            schedule_next_event();
             return;
         }
         }
     }
 
     uint8_t Timer::read_register(uint8_t reg) {
+        sync();
+
         switch (reg) {
         case 0x04:
             return read_div();
@@ -74,6 +80,8 @@ namespace GB {
         tima = 0;
         tma = 0;
         set_tac(0xF8);
+        synced_cycles = core->elapsed_cycles();
+        schedule_next_event();
     }
 
     void Timer::set_tac(uint8_t rate) {
@@ -87,12 +95,84 @@ namespace GB {
 
     uint8_t Timer::read_div() { return div_cycles >> 8; }
 
-    void Timer::update(int32_t cycles) {
+    /*
+        DIV counts CPU cycles, 4 per M-cycle at either speed, and only gets caught up when it is
+        read or written or when its next frame sequencer step or TIMA overflow is due.
+    */
+    void Timer::sync() {
+        uint64_t now = core->elapsed_cycles();
+
+        if (now == synced_cycles) {
+            return;
+        }
+
         if (core->cpu.stopped()) {
             change_div(0);
         } else {
-            change_div(div_cycles + cycles);
+            uint32_t cycles_per_dot = core->cpu.double_speed() ? 2 : 1;
+            advance(static_cast<uint32_t>(now - synced_cycles) * cycles_per_dot);
+        }
+
+        synced_cycles = now;
+    }
+
+    void Timer::schedule_next_event() {
+        uint32_t div = div_cycles;
+        uint32_t period = sequencer_period();
+        uint32_t next_edge = (div / period + 1) * period;
+
+        if (timer_enabled()) {
+            uint32_t tima_period = tac_rate * 2;
+            uint32_t overflow = (div / tima_period + (0x100 - tima)) * tima_period;
+            next_edge = std::min(next_edge, overflow);
         }
+
+        core->scheduler.schedule(EventType::Timer, edge_timestamp(next_edge));
+    }
+
+    // Same as calling change_div() every 4 cycles, but counts falling edges instead of testing.
+    void Timer::advance(uint32_t cycles) {
+        uint32_t div = div_cycles;
+        uint32_t end = div + cycles;
+        uint32_t period = sequencer_period();
+        uint64_t tick_cycles = core->cpu.double_speed() ? 2 : 4;
+
+        for (uint32_t edge = (div / period + 1) * period; edge <= end; edge += period) {
+            // DIV is bumped at the start of an M-cycle, before the APU runs through it.
+            core->apu.sync_to(edge_timestamp(edge) - tick_cycles);
+            core->apu.step_frame_sequencer();
+        }
+
+        if (timer_enabled()) {
+            uint32_t tima_period = tac_rate * 2;
+            uint32_t increments = (end / tima_period) - (div / tima_period);
+
+            while (increments) {
+                uint32_t until_overflow = 0x100 - tima;
+
+                if (increments < until_overflow) {
+                    tima += increments;
+                    break;
+                }
+
+                increments -= until_overflow;
+                tima = tma;
+                core->cpu.request_interrupt(INT_TIMER_BIT);
+            }
+        }
+
+        div_cycles = static_cast<uint16_t>(end);
+    }
+
+    // The frame sequencer is clocked by DIV bit 12, or bit 13 in double speed.
+    uint32_t Timer::sequencer_period() const {
+        return core->cpu.double_speed() ? 0x4000 : 0x2000;
+    }
+
+    // Master clock at the end of the M-cycle in which DIV reaches edge.
+    uint64_t Timer::edge_timestamp(uint32_t edge) const {
+        uint32_t cycles_per_dot = core->cpu.double_speed() ? 2 : 1;
+        return synced_cycles + (edge - div_cycles) / cycles_per_dot;
     }
 
     bool Timer::timer_enabled() const { return tac & 0b100; }
@@ -100,6 +180,7 @@ namespace GB {
     void Timer::change_div(uint16_t new_div) {
         if (EdgeFell(div_cycles >> 8, new_div >> 8,
                      core->cpu.double_speed() ? 0b100000 : 0b10000)) {
+            core->apu.sync();
             core->apu.step_frame_sequencer();
         }
 
@@ -30,19 +30,24 @@ namespace GB {
         void write_register(uint8_t reg, uint8_t value);
         uint8_t read_register(uint8_t reg);
         void reset();
-        void update(int32_t cycles);
+        void sync();
+        void schedule_next_event();
 
     private:
         void set_tac(uint8_t rate);
         void reset_div();
         uint8_t read_div();
         void change_div(uint16_t new_div);
+        void advance(uint32_t cycles);
+        uint32_t sequencer_period() const;
+        uint64_t edge_timestamp(uint32_t edge) const;
 
         Core *core;
         uint8_t tima = 0;
         uint8_t tma = 0;
-        uint8_t tac = 0;
-        uint16_t tac_rate = 0;
-        uint16_t div_cycles = 0;
+        uint8_t tac = 0xF8;
+        uint16_t tac_rate = 512;
+        uint16_t div_cycles = 0xAB00;
+        uint64_t synced_cycles = 0;
     };
 }
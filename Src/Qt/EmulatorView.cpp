@@ -24,12 +24,16 @@
 #include "OGL/GLFunctions.hpp"
 #include "OGL/Renderer.hpp"
 #include <QCoreApplication>
+#include <QFontDatabase>
 #include <QLabel>
 #include <QScreen>
 #include <QWindow>
+#include <algorithm>
 #include <fmt/format.h>
 
 namespace QtFrontend {
+    constexpr auto TELEMETRY_DISPLAY_INTERVAL = std::chrono::milliseconds(500);
+
     EmulatorThread::EmulatorThread(QObject *parent)
         : QThread(parent), input_timer(), gb_controller(new GBEmulatorController) {
 
@@ -39,6 +43,8 @@ namespace QtFrontend {
                 dynamic_cast<QOpenGLWidget *>(parent), &QWidget::hide);
         connect(this, &EmulatorThread::on_post_input, gb_controller,
                 &GBEmulatorController::copy_input);
+        connect(gb_controller, &GBEmulatorController::on_show, this,
+                &EmulatorThread::reset_telemetry);
 
         connect(&input_timer, &QTimer::timeout, this, &EmulatorThread::update_input);
 
@@ -63,22 +69,21 @@ namespace QtFrontend {
     void EmulatorThread::stop() { running = false; }
 
     void EmulatorThread::run() {
+        using clock = std::chrono::steady_clock;
+
         auto accumulator = std::chrono::nanoseconds::zero();
-        auto last_timer_time = std::chrono::steady_clock::now();
-        auto last_callback_time = std::chrono::steady_clock::now();
+        auto last_timer_time = clock::now();
+        auto last_callback_time = clock::now();
+        auto last_display_time = clock::now();
         auto interval = Common::Math::freq_to_nanoseconds(60);
-
-        std::array<double, 100> samples{};
-        size_t next = 0;
-        double current_average = 0;
+        bool was_running = false;
 
         while (running) {
             using namespace std::chrono_literals;
             QCoreApplication::processEvents();
 
             if (gb_controller->get_state() != EmulationState::Stopped) {
-                using namespace std::chrono_literals;
-                auto time_now = std::chrono::steady_clock::now();
+                auto time_now = clock::now();
                 auto delta = time_now - last_timer_time;
 
                 if (delta >= interval) {
@@ -89,43 +94,61 @@ namespace QtFrontend {
                 accumulator += delta;
 
                 if (accumulator >= interval) {
-                    auto time_now = std::chrono::steady_clock::now();
-                    auto delta = time_now - last_callback_time;
-                    last_callback_time = time_now;
-
-                    samples[next++] = static_cast<double>(
-                        std::chrono::duration_cast<std::chrono::microseconds>(delta).count());
-
-                    if (next == samples.size()) {
-                        next = 0;
-
-                        current_average = std::accumulate(samples.begin(), samples.end(), 0) /
-                                          static_cast<double>(samples.size());
-                        current_average /= 1000.0;
+                    auto frame_start = clock::now();
+                    auto frame_interval = frame_start - last_callback_time;
+                    last_callback_time = frame_start;
+
+                    bool is_running = gb_controller->get_state() == EmulationState::Running;
+                    bool emulated = gb_controller->try_run_frame();
+                    auto emulate_time = clock::now() - frame_start;
+
+                    // The first tick after a pause would measure the pause itself.
+                    if (is_running && was_running) {
+                        telemetry.record_frame(frame_interval, emulate_time,
+                                               gb_controller->get_queued_audio(), emulated);
                     }
 
-                    double fps = std::trunc(1000.0 / current_average);
-
-                    emit on_update_fps_display(QString::fromStdString(
-                        fmt::format("FPS:{} Avg:{:05.2f}ms", fps, current_average)));
-
-                    if (gb_controller->try_run_frame()) {
-                        auto &image = image_buffer.next_rendering_image();
-                        auto ppu_image = gb_controller->get_core().ppu.framebuffer();
-
-                        std::copy(ppu_image.begin(), ppu_image.end(), image.begin());
+                    was_running = is_running;
 
+                    if (emulated) {
                         emit update_textures();
                     }
 
+                    if (frame_start - last_display_time >= TELEMETRY_DISPLAY_INTERVAL) {
+                        last_display_time = frame_start;
+                        publish_telemetry();
+                    }
+
                     accumulator -= interval;
                 }
             } else {
                 accumulator = 0ns;
+                was_running = false;
             }
         }
     }
 
+    void EmulatorThread::reset_telemetry() { telemetry.reset(); }
+
+    void EmulatorThread::publish_telemetry() {
+        auto summary = telemetry.summary();
+
+        emit on_update_fps_display(QString::fromStdString(
+            fmt::format("FPS:{:.0f} p99:{:05.2f}ms", summary.fps, summary.p99_ms)));
+
+        emit on_update_telemetry(QString::fromStdString(fmt::format(
+            "FPS        {:.1f}\n"
+            "Frame ms   p50 {:.2f}  p95 {:.2f}  p99 {:.2f}\n"
+            "Emulate    {:.2f} ms\n"
+            "Present    {:.2f} ms\n"
+            "Audio      {:.1f} ms queued\n"
+            "Dropped    {}\n"
+            "Duplicated {}",
+            summary.fps, summary.p50_ms, summary.p95_ms, summary.p99_ms, summary.emulate_ms,
+            summary.present_ms, summary.audio_queue_ms, summary.dropped_frames,
+            summary.duplicated_frames)));
+    }
+
     void EmulatorThread::update_input() {
         if (gb_controller) {
             std::array<bool, 8> buttons{};
@@ -136,7 +159,14 @@ namespace QtFrontend {
 
     EmulatorView::EmulatorView(MainWindow *parent)
         : QOpenGLWidget(parent), thread(new EmulatorThread(this)), window(parent),
-          functions(new GLFunctions) {
+          functions(new GLFunctions), telemetry_overlay(new QLabel(this)) {
+        telemetry_overlay->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        telemetry_overlay->setStyleSheet(
+            "QLabel { background-color: rgba(0, 0, 0, 160); color: white; padding: 4px; }");
+        telemetry_overlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+        telemetry_overlay->move(8, 8);
+        telemetry_overlay->hide();
+
         float ratio = static_cast<float>(screen()->devicePixelRatio());
         scaled_width = static_cast<float>(width()) * ratio;
         scaled_height = static_cast<float>(height()) * ratio;
@@ -211,6 +241,9 @@ namespace QtFrontend {
         connect(thread, &EmulatorThread::on_update_fps_display, window->get_fps_counter(),
                 &QLabel::setText);
 
+        connect(thread, &EmulatorThread::on_update_telemetry, this,
+                &EmulatorView::update_telemetry_overlay);
+
         connect(thread->gb_controller, &GBEmulatorController::on_load_success, window,
                 &MainWindow::rom_load_success);
 
@@ -235,21 +268,37 @@ namespace QtFrontend {
     void EmulatorView::update_textures() {
         const auto &config = Common::Config::current().gameboy.video;
 
+        // Older frames move down by rotating the textures, only the newest one is uploaded.
         if (config.frame_blending) {
-            for (int i = (framebuffers.size() - 1); i > 0; --i) {
-                framebuffers[i] = framebuffers[i - 1];
+            std::rotate(textures.rbegin(), textures.rbegin() + 1, textures.rend());
+        }
 
-                functions->update_texture_data(textures[i], GB::LCD_WIDTH, GB::LCD_HEIGHT,
-                                               framebuffers[i]);
+        auto image = thread->gb_controller->get_core().ppu.framebuffer();
+        functions->update_texture_data(textures[0], GB::LCD_WIDTH, GB::LCD_HEIGHT, image);
 
-                functions->set_texture_filter(textures[i],
-                                              config.smooth_scaling ? GL_LINEAR : GL_NEAREST);
-            }
+        for (auto texture : textures) {
+            functions->set_texture_filter(texture, config.smooth_scaling ? GL_LINEAR : GL_NEAREST);
         }
-
-        framebuffers[0] = thread->image_buffer.next_drawing_image();
-        functions->update_texture_data(textures[0], GB::LCD_WIDTH, GB::LCD_HEIGHT, framebuffers[0]);
-        functions->set_texture_filter(textures[0], config.smooth_scaling ? GL_LINEAR : GL_NEAREST);
+        thread->telemetry.record_present();
         update();
     }
+
+    void EmulatorView::update_telemetry_overlay(const QString &text) {
+        const auto show_telemetry = Common::Config::current().gameboy.video.show_telemetry;
+
+        if (show_telemetry) {
+            telemetry_overlay->setText(text);
+            telemetry_overlay->adjustSize();
+        }
+
+        telemetry_overlay->setVisible(show_telemetry);
+    }
+
+    bool EmulatorView::write_telemetry(const std::filesystem::path &path) {
+        if (path.extension() == ".json") {
+            return thread->telemetry.write_json(path);
+        }
+
+        return thread->telemetry.write_csv(path);
+    }
 }
\ No newline at end of file
@@ -18,7 +18,7 @@
 
 #pragma once
 #include "Cores/GB/Constants.hpp"
-#include "SwapChain.hpp"
+#include "FrameTelemetry.hpp"
 #include <QOpenGLWidget>
 #include <QThread>
 #include <QTimer>
@@ -26,8 +26,11 @@
 #include <array>
 #include <atomic>
 #include <chrono>
+#include <filesystem>
 #include <mutex>
 
+class QLabel;
+
 namespace GL {
     class Renderer;
     class Context;
@@ -54,17 +57,21 @@ namespace QtFrontend {
         void run() override;
 
         void update_input();
+        Q_SLOT void reset_telemetry();
         Q_SIGNAL void on_update_fps_display(const QString &text);
+        Q_SIGNAL void on_update_telemetry(const QString &text);
         Q_SIGNAL void on_post_input(std::array<bool, 8> input);
         Q_SIGNAL void update_textures();
 
     private:
+        void publish_telemetry();
+
         std::atomic_bool running = true;
 
         QTimer input_timer;
 
         GBEmulatorController *gb_controller = nullptr;
-        SwapChain<GB::LCD_WIDTH * GB::LCD_HEIGHT * 4> image_buffer;
+        FrameTelemetry telemetry{};
 
         friend class EmulatorView;
     };
@@ -87,7 +94,9 @@ namespace QtFrontend {
         void paintGL() override;
 
         void connect_slots();
+        bool write_telemetry(const std::filesystem::path &path);
         Q_SLOT void update_textures();
+        Q_SLOT void update_telemetry_overlay(const QString &text);
 
     private:
         float scaled_width = 0.0, scaled_height = 0.0;
@@ -96,8 +105,8 @@ namespace QtFrontend {
         MainWindow *window = nullptr;
         GLFunctions *functions = nullptr;
         Renderer *renderer = nullptr;
+        QLabel *telemetry_overlay = nullptr;
 
         std::array<GLuint, 2> textures{};
-        std::array<std::array<uint8_t, GB::LCD_WIDTH * GB::LCD_HEIGHT * 4>, 2> framebuffers{};
     };
 }
\ No newline at end of file
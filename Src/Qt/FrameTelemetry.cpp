@@ -0,0 +1,213 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "FrameTelemetry.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <fstream>
+
+namespace QtFrontend {
+    // Averages shown in the summary cover roughly the last second.
+    constexpr size_t SUMMARY_WINDOW = 60;
+
+    FrameTelemetry::FrameTelemetry() : history(TELEMETRY_HISTORY_SIZE) {}
+
+    void FrameTelemetry::reset() {
+        std::lock_guard lock(mutex);
+
+        std::fill(history.begin(), history.end(), FrameSample{});
+        next_sample = 0;
+        sample_count = 0;
+        histogram.fill(0);
+        frames = 0;
+        dropped_frames = 0;
+        duplicated_frames = 0;
+        unpresented_frames = 0;
+    }
+
+    void FrameTelemetry::record_frame(std::chrono::nanoseconds interval,
+                                      std::chrono::nanoseconds emulate,
+                                      std::chrono::microseconds audio_queue, bool emulated) {
+        std::lock_guard lock(mutex);
+
+        auto &sample = history[next_sample];
+        sample = FrameSample{
+            .frame = frames++,
+            .interval_ns = interval.count(),
+            .emulate_ns = emulate.count(),
+            .audio_queue_us = audio_queue.count(),
+            .emulated = emulated,
+        };
+
+        next_sample = (next_sample + 1) % history.size();
+        sample_count = std::min(sample_count + 1, history.size());
+
+        auto bucket = static_cast<size_t>(std::max<int64_t>(interval.count(), 0) /
+                                          TELEMETRY_BUCKET_NS);
+        histogram[std::min(bucket, histogram.size() - 1)]++;
+
+        if (emulated) {
+            unpresented_frames++;
+            last_produced = clock::now();
+        } else {
+            duplicated_frames++;
+        }
+    }
+
+    void FrameTelemetry::record_present() {
+        std::lock_guard lock(mutex);
+
+        if (unpresented_frames == 0) {
+            return;
+        }
+
+        dropped_frames += unpresented_frames - 1;
+        unpresented_frames = 0;
+
+        auto last = (next_sample + history.size() - 1) % history.size();
+        history[last].present_ns = (clock::now() - last_produced).count();
+    }
+
+    TelemetrySummary FrameTelemetry::summary() const {
+        std::lock_guard lock(mutex);
+        return summarize();
+    }
+
+    bool FrameTelemetry::write_csv(const std::filesystem::path &path) const {
+        std::ofstream out(path);
+
+        if (!out) {
+            return false;
+        }
+
+        std::lock_guard lock(mutex);
+        out << "frame,interval_ms,emulate_ms,present_ms,audio_queue_ms,emulated\n";
+
+        auto first = (next_sample + history.size() - sample_count) % history.size();
+        for (size_t i = 0; i < sample_count; ++i) {
+            const auto &sample = history[(first + i) % history.size()];
+
+            out << fmt::format("{},{:.3f},{:.3f},{:.3f},{:.3f},{}\n", sample.frame,
+                               sample.interval_ns / 1e6, sample.emulate_ns / 1e6,
+                               sample.present_ns / 1e6, sample.audio_queue_us / 1e3,
+                               sample.emulated ? 1 : 0);
+        }
+
+        return static_cast<bool>(out);
+    }
+
+    bool FrameTelemetry::write_json(const std::filesystem::path &path) const {
+        std::ofstream out(path);
+
+        if (!out) {
+            return false;
+        }
+
+        std::lock_guard lock(mutex);
+        auto summary = summarize();
+
+        out << "{\n";
+        out << fmt::format("  \"frames\": {},\n  \"dropped_frames\": {},\n"
+                           "  \"duplicated_frames\": {},\n",
+                           summary.frames, summary.dropped_frames, summary.duplicated_frames);
+        out << fmt::format("  \"fps\": {:.2f},\n  \"frame_time_ms\": {{\"p50\": {:.2f}, \"p95\": "
+                           "{:.2f}, \"p99\": {:.2f}}},\n",
+                           summary.fps, summary.p50_ms, summary.p95_ms, summary.p99_ms);
+        out << fmt::format("  \"emulate_ms\": {:.3f},\n  \"present_ms\": {:.3f},\n"
+                           "  \"audio_queue_ms\": {:.2f},\n",
+                           summary.emulate_ms, summary.present_ms, summary.audio_queue_ms);
+        out << fmt::format("  \"histogram\": {{\"bucket_ms\": {:.2f}, \"counts\": [",
+                           TELEMETRY_BUCKET_NS / 1e6);
+
+        for (size_t i = 0; i < histogram.size(); ++i) {
+            out << (i ? ", " : "") << histogram[i];
+        }
+
+        out << "]}\n}\n";
+
+        return static_cast<bool>(out);
+    }
+
+    double FrameTelemetry::percentile_ms(double p) const {
+        uint64_t total = 0;
+
+        for (auto count : histogram) {
+            total += count;
+        }
+
+        if (total == 0) {
+            return 0.0;
+        }
+
+        auto rank = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(total)));
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < histogram.size(); ++i) {
+            seen += histogram[i];
+
+            if (seen >= rank) {
+                // Report the upper edge of the bucket the percentile landed in.
+                return static_cast<double>((i + 1) * TELEMETRY_BUCKET_NS) / 1e6;
+            }
+        }
+
+        return static_cast<double>(histogram.size() * TELEMETRY_BUCKET_NS) / 1e6;
+    }
+
+    TelemetrySummary FrameTelemetry::summarize() const {
+        TelemetrySummary summary{
+            .frames = frames,
+            .dropped_frames = dropped_frames,
+            .duplicated_frames = duplicated_frames,
+            .p50_ms = percentile_ms(50),
+            .p95_ms = percentile_ms(95),
+            .p99_ms = percentile_ms(99),
+        };
+
+        auto window = std::min(sample_count, SUMMARY_WINDOW);
+
+        if (window == 0) {
+            return summary;
+        }
+
+        int64_t interval_ns = 0, emulate_ns = 0, present_ns = 0, audio_queue_us = 0;
+        size_t presented = 0;
+
+        for (size_t i = 1; i <= window; ++i) {
+            const auto &sample = history[(next_sample + history.size() - i) % history.size()];
+            interval_ns += sample.interval_ns;
+            emulate_ns += sample.emulate_ns;
+            audio_queue_us += sample.audio_queue_us;
+
+            if (sample.present_ns) {
+                present_ns += sample.present_ns;
+                presented++;
+            }
+        }
+
+        auto count = static_cast<double>(window);
+        summary.fps = interval_ns ? (1e9 * count / static_cast<double>(interval_ns)) : 0.0;
+        summary.emulate_ms = static_cast<double>(emulate_ns) / count / 1e6;
+        summary.present_ms =
+            presented ? static_cast<double>(present_ns) / static_cast<double>(presented) / 1e6
+                      : 0.0;
+        summary.audio_queue_ms = static_cast<double>(audio_queue_us) / count / 1e3;
+
+        return summary;
+    }
+}
@@ -0,0 +1,97 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace QtFrontend {
+    constexpr size_t TELEMETRY_HISTORY_SIZE = 3600;
+    constexpr int64_t TELEMETRY_BUCKET_NS = 250000;
+    // 0.25ms buckets up to 50ms, the last bucket collects everything slower.
+    constexpr size_t TELEMETRY_BUCKET_COUNT = 201;
+
+    struct FrameSample {
+        uint64_t frame = 0;
+        // Time since the previous frame tick, the value the histogram is built from.
+        int64_t interval_ns = 0;
+        int64_t emulate_ns = 0;
+        // Time from a frame being handed to the GUI thread until its texture upload finished.
+        int64_t present_ns = 0;
+        int64_t audio_queue_us = 0;
+        bool emulated = false;
+    };
+
+    struct TelemetrySummary {
+        uint64_t frames = 0;
+        uint64_t dropped_frames = 0;
+        uint64_t duplicated_frames = 0;
+        double fps = 0.0;
+        double p50_ms = 0.0;
+        double p95_ms = 0.0;
+        double p99_ms = 0.0;
+        double emulate_ms = 0.0;
+        double present_ms = 0.0;
+        double audio_queue_ms = 0.0;
+    };
+
+    /*
+        Frame pacing statistics shared by the emulator thread, which records one sample per frame
+        tick, and the GUI thread, which records when a frame reaches the screen.
+
+        A frame is dropped when a newer one replaced it before the GUI thread got to present it,
+        and duplicated when a tick produced no new frame (audio was running ahead) so the previous
+        image stayed on screen.
+    */
+    class FrameTelemetry {
+    public:
+        FrameTelemetry();
+
+        void reset();
+        void record_frame(std::chrono::nanoseconds interval, std::chrono::nanoseconds emulate,
+                          std::chrono::microseconds audio_queue, bool emulated);
+        void record_present();
+
+        TelemetrySummary summary() const;
+        bool write_csv(const std::filesystem::path &path) const;
+        bool write_json(const std::filesystem::path &path) const;
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        double percentile_ms(double p) const;
+        TelemetrySummary summarize() const;
+
+        mutable std::mutex mutex;
+
+        std::vector<FrameSample> history;
+        size_t next_sample = 0;
+        size_t sample_count = 0;
+        std::array<uint64_t, TELEMETRY_BUCKET_COUNT> histogram{};
+
+        uint64_t frames = 0;
+        uint64_t dropped_frames = 0;
+        uint64_t duplicated_frames = 0;
+        uint64_t unpresented_frames = 0;
+        clock::time_point last_produced{};
+    };
+}
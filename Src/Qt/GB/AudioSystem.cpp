@@ -68,6 +68,17 @@ namespace QtFrontend {
         return true;
     }
 
+    std::chrono::microseconds AudioSystem::queued_duration() const {
+        if (!opened || obtained.freq == 0) {
+            return std::chrono::microseconds::zero();
+        }
+
+        auto samples_queued =
+            static_cast<int64_t>(SDL_GetQueuedAudioSize(audio_device) / sizeof(AudioSample));
+
+        return std::chrono::microseconds(samples_queued * 1000000 / obtained.freq);
+    }
+
     void AudioSystem::operator()(GB::SampleResult result) {
         const auto &config = Common::Config::current().gameboy;
 
@@ -19,6 +19,7 @@
 #pragma once
 #include "Cores/GB/APU.hpp"
 #include <SDL.h>
+#include <chrono>
 #include <vector>
 
 namespace QtFrontend {
@@ -39,6 +40,7 @@ namespace QtFrontend {
         void open_device();
         void close_device();
         bool should_continue();
+        std::chrono::microseconds queued_duration() const;
         void operator()(GB::SampleResult result);
         void prep_for_playback(GB::APU &apu);
 
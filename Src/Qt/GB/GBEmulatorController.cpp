@@ -31,10 +31,15 @@ namespace QtFrontend {
 
     GB::Core &GBEmulatorController::get_core() { return core; }
 
+    std::chrono::microseconds GBEmulatorController::get_queued_audio() const {
+        return audio_system.queued_duration();
+    }
+
     bool GBEmulatorController::try_run_frame() {
         using namespace std::chrono_literals;
 
         if (state == EmulationState::Running && audio_system.should_continue()) {
+            core.ppu.set_color_correction(Common::Config::current().gameboy.video.color_correction);
             core.run_for_frames(1);
             return true;
         }
@@ -48,6 +48,7 @@ namespace QtFrontend {
 
         EmulationState get_state() const;
         GB::Core &get_core();
+        std::chrono::microseconds get_queued_audio() const;
 
         bool try_run_frame();
         void process_input(std::array<bool, 8> &buttons);
@@ -19,6 +19,8 @@
 #include "VideoWindow.hpp"
 #include "ui_VideoWindow.h"
 #include <QtWidgets/qcheckbox.h>
+#include <QtWidgets/qcombobox.h>
+#include <algorithm>
 
 namespace QtFrontend {
     VideoWindow::VideoWindow(QWidget *parent)
@@ -28,8 +30,14 @@ namespace QtFrontend {
         connect(ui->buttonGroup, &QButtonGroup::buttonClicked, this,
                 &VideoWindow::select_scaling_mode);
         connect(ui->blending_box, &QCheckBox::clicked, this, &VideoWindow::set_blending_enabled);
+        connect(ui->telemetry_box, &QCheckBox::clicked, this,
+                &VideoWindow::set_telemetry_enabled);
+        connect(ui->color_correction_box, &QComboBox::currentIndexChanged, this,
+                &VideoWindow::set_color_correction);
 
         ui->blending_box->setChecked(video.frame_blending);
+        ui->telemetry_box->setChecked(video.show_telemetry);
+        ui->color_correction_box->setCurrentIndex(static_cast<int>(video.color_correction));
 
         if (video.smooth_scaling) {
             ui->smooth_radio->setChecked(true);
@@ -47,6 +55,18 @@ namespace QtFrontend {
 
     void VideoWindow::set_blending_enabled(bool checked) { video.frame_blending = checked; }
 
+    void VideoWindow::set_telemetry_enabled(bool checked) { video.show_telemetry = checked; }
+
+    void VideoWindow::set_color_correction(int index) {
+        // The combo box reports -1 when it is cleared.
+        if (index < 0) {
+            return;
+        }
+
+        video.color_correction = static_cast<GB::ColorCorrection>(
+            std::min(index, static_cast<int>(GB::ColorCorrection::Gamma)));
+    }
+
     void VideoWindow::select_scaling_mode(QAbstractButton *btn) {
         video.smooth_scaling = (btn == ui->smooth_radio);
     }
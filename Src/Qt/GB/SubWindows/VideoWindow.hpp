@@ -40,6 +40,8 @@ namespace QtFrontend {
 
         Q_SLOT void apply_changes();
         Q_SLOT void set_blending_enabled(bool checked);
+        Q_SLOT void set_telemetry_enabled(bool checked);
+        Q_SLOT void set_color_correction(int index);
         Q_SLOT void select_scaling_mode(QAbstractButton *btn);
 
     private:
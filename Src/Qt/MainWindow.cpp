@@ -115,6 +115,25 @@ namespace QtFrontend {
         emit rom_loaded(filePath);
     }
 
+    void MainWindow::save_telemetry() {
+        auto path = QFileDialog::getSaveFileName(this, tr("Save Frame Telemetry"), QString(),
+                                                 tr("CSV (*.csv);;JSON (*.json)"));
+
+        if (path.isEmpty()) {
+            return;
+        }
+
+        if (emulator_widget->write_telemetry(path.toStdString())) {
+            statusBar()->showMessage(QString::fromStdString(fmt::format(
+                                         "Frame telemetry saved to '{}'", path.toStdString())),
+                                     5000);
+        } else {
+            statusBar()->showMessage(
+                QString::fromStdString(fmt::format("Unable to save '{}'", path.toStdString())),
+                5000);
+        }
+    }
+
     void MainWindow::open_gb_settings() {
         if (!settings) {
             int32_t menu = 0;
@@ -171,6 +190,7 @@ namespace QtFrontend {
         connect(&input_timer, &QTimer::timeout, this, &MainWindow::update_controllers);
         connect(ui->actionLoad, &QAction::triggered, this, &MainWindow::open_rom_file_browser);
         connect(ui->actionExit, &QAction::triggered, this, &MainWindow::close);
+        connect(ui->actionSave_Telemetry, &QAction::triggered, this, &MainWindow::save_telemetry);
         connect(ui->actionEmulation, &QAction::triggered, this, &MainWindow::open_gb_settings);
         connect(ui->actionVideo, &QAction::triggered, this, &MainWindow::open_gb_settings);
         connect(ui->actionAudio, &QAction::triggered, this, &MainWindow::open_gb_settings);
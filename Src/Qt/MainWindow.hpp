@@ -61,6 +61,7 @@ namespace QtFrontend {
 
         Q_SLOT void open_rom_file_browser();
         Q_SLOT void open_rom_from_recents(QAction *action);
+        Q_SLOT void save_telemetry();
         Q_SLOT void open_gb_settings();
         Q_SLOT void open_about();
         Q_SLOT void clear_settings_ptr();
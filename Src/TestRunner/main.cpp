@@ -0,0 +1,383 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Cores/GB/Core.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace TestRunner {
+    // Sidecar next to a ROM holding "<frame> <hash>" for tests judged by their final screen.
+    constexpr std::string_view HASH_EXTENSION = ".hash";
+
+    struct Options {
+        std::filesystem::path rom_dir;
+        int32_t frames = 3600;
+        int32_t jobs = 0;
+        double min_fps = 0.0;
+        bool write_hashes = false;
+        bool block_cache = false;
+    };
+
+    enum class Verdict {
+        Pass,
+        Fail,
+        Timeout,
+        Recorded,
+        Error,
+    };
+
+    struct ExpectedHash {
+        int32_t frame = 0;
+        uint64_t hash = 0;
+    };
+
+    struct TestResult {
+        std::filesystem::path rom_path{};
+        Verdict verdict = Verdict::Error;
+        std::string detail{};
+        int32_t frames = 0;
+        double fps = 0.0;
+        bool too_slow = false;
+    };
+
+    void print_usage() {
+        std::cerr << "Usage: BigComBoyTestRunner <rom directory> [--frames N] [--jobs N]\n"
+                     "                           [--min-fps N] [--write-hashes] [--block-cache]\n";
+    }
+
+    // Parses the whole of text as a number; value is left unchanged when it is not one.
+    template <typename T> bool parse_number(std::string_view text, T &value) {
+        const char *end = text.data() + text.size();
+        auto [last, error] = std::from_chars(text.data(), end, value);
+
+        return error == std::errc{} && last == end;
+    }
+
+    bool parse_arguments(int argc, char *argv[], Options &options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            bool has_value = (i + 1) < argc;
+
+            if (arg == "--frames" && has_value) {
+                if (!parse_number(argv[++i], options.frames)) {
+                    return false;
+                }
+            } else if (arg == "--jobs" && has_value) {
+                if (!parse_number(argv[++i], options.jobs)) {
+                    return false;
+                }
+            } else if (arg == "--min-fps" && has_value) {
+                if (!parse_number(argv[++i], options.min_fps)) {
+                    return false;
+                }
+            } else if (arg == "--write-hashes") {
+                options.write_hashes = true;
+            } else if (arg == "--block-cache") {
+                options.block_cache = true;
+            } else if (!arg.starts_with("--") && options.rom_dir.empty()) {
+                options.rom_dir = arg;
+            } else {
+                return false;
+            }
+        }
+
+        if (options.jobs <= 0) {
+            options.jobs = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        return !options.rom_dir.empty() && options.frames > 0;
+    }
+
+    std::vector<std::filesystem::path> find_roms(const std::filesystem::path &dir) {
+        std::vector<std::filesystem::path> roms;
+
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(dir)) {
+            auto extension = entry.path().extension();
+
+            if (entry.is_regular_file() && (extension == ".gb" || extension == ".gbc")) {
+                roms.push_back(entry.path());
+            }
+        }
+
+        std::sort(roms.begin(), roms.end());
+        return roms;
+    }
+
+    uint64_t hash_framebuffer(std::span<const uint8_t> framebuffer) {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+
+        for (auto byte : framebuffer) {
+            hash ^= byte;
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    std::filesystem::path hash_path(const std::filesystem::path &rom_path) {
+        auto path = rom_path;
+        path += HASH_EXTENSION;
+        return path;
+    }
+
+    std::optional<ExpectedHash> read_expected_hash(const std::filesystem::path &rom_path) {
+        std::ifstream in(hash_path(rom_path));
+        ExpectedHash expected{};
+
+        if (in && (in >> expected.frame >> std::hex >> expected.hash) && expected.frame > 0) {
+            return expected;
+        }
+
+        return std::nullopt;
+    }
+
+    bool write_expected_hash(const std::filesystem::path &rom_path, int32_t frame, uint64_t hash) {
+        std::ofstream out(hash_path(rom_path));
+        out << frame << " " << std::hex << std::setw(16) << std::setfill('0') << hash << "\n";
+        return static_cast<bool>(out);
+    }
+
+    // Understands the two common conventions: blargg's text output and mooneye's register dump.
+    std::optional<bool> serial_verdict(const std::string &output) {
+        static constexpr std::string_view MOONEYE_PASS{"\x03\x05\x08\x0D\x15\x22"};
+        static constexpr std::string_view MOONEYE_FAIL{"\x42\x42\x42\x42\x42\x42"};
+
+        if (output.find("Passed") != std::string::npos || output.ends_with(MOONEYE_PASS)) {
+            return true;
+        }
+
+        if (output.find("Failed") != std::string::npos || output.ends_with(MOONEYE_FAIL)) {
+            return false;
+        }
+
+        return std::nullopt;
+    }
+
+    std::string last_line(const std::string &output) {
+        std::string line, last;
+
+        for (auto c : output) {
+            if (c == '\n') {
+                if (!line.empty()) {
+                    last = std::move(line);
+                    line.clear();
+                }
+            } else if (c >= 0x20 && c < 0x7F) {
+                line.push_back(c);
+            }
+        }
+
+        return line.empty() ? last : line;
+    }
+
+    TestResult run_test(const std::filesystem::path &rom_path, const Options &options) {
+        using clock = std::chrono::steady_clock;
+
+        TestResult result{.rom_path = rom_path};
+        auto cart = GB::Cartridge::from_file(rom_path);
+
+        if (!cart) {
+            result.detail = "failed to load ROM";
+            return result;
+        }
+
+        auto expected = read_expected_hash(rom_path);
+        auto frame_limit = expected ? expected->frame : options.frames;
+
+        std::string serial_output;
+        std::optional<bool> passed;
+
+        auto core = std::make_unique<GB::Core>();
+        core->initialize(cart.get());
+        core->cpu.set_block_cache_enabled(options.block_cache);
+        core->serial.set_transfer_callback(
+            [&serial_output](uint8_t value) { serial_output.push_back(static_cast<char>(value)); });
+
+        auto start = clock::now();
+
+        while (result.frames < frame_limit) {
+            core->run_for_frames(1);
+            result.frames++;
+
+            if (!expected) {
+                passed = serial_verdict(serial_output);
+
+                if (passed) {
+                    break;
+                }
+            }
+        }
+
+        auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+        result.fps = seconds > 0.0 ? result.frames / seconds : 0.0;
+        result.too_slow = result.fps < options.min_fps;
+
+        if (expected) {
+            auto hash = hash_framebuffer(core->ppu.framebuffer());
+            std::ostringstream detail;
+            detail << std::hex << std::setfill('0') << "frame hash " << std::setw(16) << hash;
+
+            if (hash == expected->hash) {
+                result.verdict = Verdict::Pass;
+            } else {
+                result.verdict = Verdict::Fail;
+                detail << ", expected " << std::setw(16) << expected->hash;
+            }
+
+            result.detail = detail.str();
+        } else if (passed) {
+            result.verdict = *passed ? Verdict::Pass : Verdict::Fail;
+            result.detail = last_line(serial_output);
+        } else if (options.write_hashes) {
+            auto hash = hash_framebuffer(core->ppu.framebuffer());
+
+            if (write_expected_hash(rom_path, result.frames, hash)) {
+                result.verdict = Verdict::Recorded;
+                result.detail = "recorded " + hash_path(rom_path).filename().string();
+            } else {
+                result.detail = "failed to write " + hash_path(rom_path).string();
+            }
+        } else {
+            result.verdict = Verdict::Timeout;
+            result.detail = "no serial result or " + std::string(HASH_EXTENSION) + " file";
+        }
+
+        return result;
+    }
+
+    // One core per worker, each worker pulls the next ROM until none are left.
+    std::vector<TestResult> run_all(const std::vector<std::filesystem::path> &roms,
+                                    const Options &options) {
+        std::vector<TestResult> results(roms.size());
+        std::atomic_size_t next = 0;
+        std::vector<std::thread> workers;
+
+        auto worker_count = std::min(static_cast<size_t>(options.jobs), roms.size());
+
+        for (size_t i = 0; i < worker_count; ++i) {
+            workers.emplace_back([&]() {
+                for (auto index = next++; index < roms.size(); index = next++) {
+                    results[index] = run_test(roms[index], options);
+                }
+            });
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        return results;
+    }
+
+    std::string_view verdict_name(Verdict verdict) {
+        switch (verdict) {
+        case Verdict::Pass:
+            return "PASS";
+        case Verdict::Fail:
+            return "FAIL";
+        case Verdict::Timeout:
+            return "TIMEOUT";
+        case Verdict::Recorded:
+            return "RECORDED";
+        case Verdict::Error:
+            return "ERROR";
+        }
+        return "";
+    }
+
+    bool write_report(std::ostream &out, const Options &options,
+                      const std::vector<TestResult> &results) {
+        std::array<size_t, 5> counts{};
+        size_t too_slow = 0;
+
+        out << std::fixed << std::setprecision(1);
+
+        for (const auto &result : results) {
+            counts[static_cast<size_t>(result.verdict)]++;
+            too_slow += result.too_slow ? 1 : 0;
+
+            out << std::left << std::setw(9) << verdict_name(result.verdict) << std::right
+                << std::setw(6) << result.frames << " frames " << std::setw(9) << result.fps
+                << " fps" << (result.too_slow ? " SLOW " : "      ")
+                << std::filesystem::relative(result.rom_path, options.rom_dir).string();
+
+            if (!result.detail.empty()) {
+                out << " (" << result.detail << ")";
+            }
+
+            out << "\n";
+        }
+
+        out << "\n"
+            << results.size() << " ROMs: " << counts[static_cast<size_t>(Verdict::Pass)]
+            << " passed, " << counts[static_cast<size_t>(Verdict::Fail)] << " failed, "
+            << counts[static_cast<size_t>(Verdict::Timeout)] << " timed out, "
+            << counts[static_cast<size_t>(Verdict::Error)] << " errors, "
+            << counts[static_cast<size_t>(Verdict::Recorded)] << " recorded";
+
+        if (options.min_fps > 0.0) {
+            out << ", " << too_slow << " below " << options.min_fps << " fps";
+        }
+
+        out << "\n";
+
+        return (counts[static_cast<size_t>(Verdict::Fail)] +
+                counts[static_cast<size_t>(Verdict::Timeout)] +
+                counts[static_cast<size_t>(Verdict::Error)] + too_slow) == 0;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    TestRunner::Options options{};
+
+    if (!TestRunner::parse_arguments(argc, argv, options)) {
+        TestRunner::print_usage();
+        return 1;
+    }
+
+    if (!std::filesystem::is_directory(options.rom_dir)) {
+        std::cerr << "Not a directory: " << options.rom_dir.string() << "\n";
+        return 1;
+    }
+
+    auto roms = TestRunner::find_roms(options.rom_dir);
+
+    if (roms.empty()) {
+        std::cerr << "No ROMs found in " << options.rom_dir.string() << "\n";
+        return 1;
+    }
+
+    auto results = TestRunner::run_all(roms, options);
+    return TestRunner::write_report(std::cout, options, results) ? 0 : 1;
+}